@@ -5,12 +5,42 @@
     @brief API for Analog-Digital Converter
 */
 
+#include <stdint.h>
+#include <avr/io.h>
+#include "config.h"
+
+/* Internal 2.56V voltage reference */
+#define ADC_REFERENCE ((1<<REFS1)|(1<<REFS0))
+#define ADC_REFERENCE_MV 2560
+#define ADC_RESOLUTION 1024
+#define ADC_MAX_DECIMATION_SHIFT 6  /* 2^6 * 1023 still fits in 16-bit accumulator */
+
+#define ADC_DS_CHANNEL(name, pin, filter, window, angle) CH_##name = ADC_REFERENCE | (pin),
+
+/**
+ * @brief ADMUX values (reference + MUX bits) of channels used in scan, CH_<name> of every DS in DS_TOPOLOGY
+ */
 typedef enum ADC_CHANNEL_ID_Tag{
-    CH_DS1 = 0xC1,
-    CH_DS2 = 0xC0
+    DS_TOPOLOGY(ADC_DS_CHANNEL)
+    CH_BATTERY = ADC_REFERENCE | BATTERY_SENSE
 }ADC_CHANNEL_ID_T;
 
+/**
+ * @brief Callback receiving conversion results of a scan entry, @arg is taken from the scan entry
+ */
+typedef void (*ADC_Sink_T)(uint8_t arg, uint16_t adc_val);
+
+/**
+ * @brief Single entry of ADC scan list (ADC_SCAN_LIST in config.h)
+ */
+typedef struct ADC_Scan_Entry_Tag{
+    uint8_t channel;            /* ADC_CHANNEL_ID_T */
+    uint8_t decimation_shift;   /* Sink is called with the average of every 2^n conversions, max ADC_MAX_DECIMATION_SHIFT */
+    ADC_Sink_T sink;
+    uint8_t sink_arg;
+}ADC_Scan_Entry_T;
+
 void ADC_init(void);
-void ADC_switch_channel(ADC_CHANNEL_ID_T channel_id);
+void ADC_on_conversion_complete(void);
 
 #endif /* ADC_GUARD */
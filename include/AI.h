@@ -8,6 +8,7 @@
 typedef enum AI_Status_Tag{
     AI_IDLE = 0,
     AI_ARMED,       /* Set to activate in few secconds (button trigger) */
+    AI_OPENING,     /* Playing opening move, until first sensor input */
     AI_SEARCH,      /* Actively searching for target*/
     AI_TRACKING,    /* Distance sensors triggered, no confirmation on target*/
     AI_ATTACK,      /* Target confirmed, moving in */
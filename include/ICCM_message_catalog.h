@@ -1,13 +1,21 @@
 #ifndef ICCM_MESSAGE_CATALOG_GUARD
 #define ICCM_MESSAGE_CATALOG_GUARD
 
+/* Limits of MOTORS_BATTERY_CORRECTION argument, encoded by MCU1 and validated by MCU2 */
+#define BATTERY_CORRECTION_NONE 100     /* percent */
+#define BATTERY_CORRECTION_MIN  50
+#define BATTERY_CORRECTION_MAX  150
+
 #ifdef MCU1
 #define MOTORS_GO_FORWARD  "F"
 #define MOTORS_GO_BACKWARD "B"
 #define MOTORS_TURN_RIGHT  "R"
 #define MOTORS_TURN_LEFT   "L"
-#define MOTORS_STOP        "S"
-#define MOTORS_PWM_10      "1"
+#define MOTORS_STOP        "S"          /* coasting stop, same as MOTORS_STOP_COAST */
+#define MOTORS_STOP_COAST  "SC"         /* motors spin out */
+#define MOTORS_STOP_BRAKE  "SB"         /* short brake */
+#define MOTORS_STOP_REVERSE "SR"        /* reverse thrust pulse followed by short brake */
+#define MOTORS_PWM_20      "2"
 #define MOTORS_PWM_30      "3"
 #define MOTORS_PWM_40      "4"
 #define MOTORS_PWM_50      "5"
@@ -16,6 +24,13 @@
 #define MOTORS_PWM_80      "8"
 #define MOTORS_PWM_90      "9"
 #define MOTORS_PWM_100     "X"
+#define MOTORS_BATTERY_CORRECTION "V"   /* followed by decimal correction in percent, e.g. "V105" */
+#define MOTORS_SET_DUTY    "D"          /* followed by duty 0-255 as 2 hex digits, e.g. "D80" */
+#define MOTORS_SET_MOTORS  "M"          /* followed by signed duty of M1..M4 as sign and 2 hex digits, e.g. "M+80-80+80-80" */
+#define MOTORS_QUEUE       "Q"          /* followed by up to 3 motion primitives, replaces MCU2 motion queue */
+#define MOTORS_QUEUE_APPEND "A"         /* followed by up to 3 motion primitives, appended to MCU2 motion queue */
+#define MOTORS_SET_TRIMS   "T"          /* followed by trims of M1..M4 as 3 hex digits (100 = 1.0), stored in MCU2 EEPROM, e.g. "T1001000F00F0" */
+/* Motion primitive: movement cmd (F/B/R/L/S), duty as 2 hex digits, duration in ms as 3 hex digits, e.g. "B99064" */
 #endif
 
 #ifdef MCU2
@@ -24,6 +39,9 @@
 #define MOTORS_TURN_RIGHT  'R'
 #define MOTORS_TURN_LEFT   'L'
 #define MOTORS_STOP        'S'
+#define MOTORS_BRAKE_COAST 'C'          /* brake modes, second character of stop command */
+#define MOTORS_BRAKE_SHORT 'B'
+#define MOTORS_BRAKE_REVERSE 'R'
 #define MOTORS_PWM_20      '2'
 #define MOTORS_PWM_30      '3'
 #define MOTORS_PWM_40      '4'
@@ -33,6 +51,12 @@
 #define MOTORS_PWM_80      '8'
 #define MOTORS_PWM_90      '9'
 #define MOTORS_PWM_100     'X'
+#define MOTORS_BATTERY_CORRECTION 'V'
+#define MOTORS_SET_DUTY    'D'
+#define MOTORS_SET_MOTORS  'M'
+#define MOTORS_QUEUE       'Q'
+#define MOTORS_QUEUE_APPEND 'A'
+#define MOTORS_SET_TRIMS   'T'
 #endif
 
 #endif /* ICCM_MESSAGE_CATALOG_GUARD */
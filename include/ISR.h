@@ -11,51 +11,31 @@
     #include "serial_rx.h"
     #include "ICCM.h"
     #include "config.h"
-    #include "ADC.h"
 
 
     #ifdef MCU1
-        #include "distance_sensor.h"
-        static uint8_t current_ADC_channel = CH_DS1;
-
+        #include "ADC.h"
+        #include "sys_tick.h"
+        #include "line_sensor.h"
         /**
          * @brief Interrupt routine executed when ADC completes conversion
          */
         ISR(ADC_vect){  
-            volatile uint16_t adc_val = ADCW;
-            switch(current_ADC_channel){
-                case CH_DS1:
-                    ADC_switch_channel(CH_DS1);
-                    distance_sensor_read_ADC(DS1_ID, adc_val);
-                    current_ADC_channel = CH_DS2;
-                    break;
-                case CH_DS2:
-                    ADC_switch_channel(CH_DS2);
-                    distance_sensor_read_ADC(DS2_ID, adc_val);
-                    current_ADC_channel = CH_DS1;
-                    break;
-                default:
-                    break;
-            }
+            ADC_on_conversion_complete();
         }
 
         /**
-         * @brief
+         * @brief Interrupt routine of system time base (1 ms), also used to sample line sensors
          */
-        ISR(TIMER0_OVF_vect){  
-            static uint8_t cnt = 0;
-            if(cnt >= 5){
-                /* Trigger ADC conversion */
-                ADCSRA |= 1<<ADSC;
-                cnt = 0;
-            } else {
-                ++cnt;
-            }
+        ISR(TIMER2_COMP_vect){
+            sys_tick_on_tick();
+            line_sensor_sample();
         }
     #endif
     
     #ifdef MCU2
         #include "drive_ctrl.h"
+        #include "sys_tick.h"
 
         /**
          * @brief Interrupt routine to control PWM of motor drivers
@@ -63,6 +43,13 @@
         ISR(TIMER0_OVF_vect){  
             drive_ctrl_PWM_processing();
         }  
+
+        /**
+         * @brief Interrupt routine of system time base (TIMER2 compare match, every 1 ms), times motion primitives
+         */
+        ISR(TIMER2_COMP_vect){
+            sys_tick_on_tick();
+        }
     #endif
 
     /**
@@ -74,6 +61,14 @@
         serial_on_receive(c);
     }
 
+    /**
+     * @brief Interrupt routine for USART data register empty
+     * Sends the next queued character, disabled by serial_tx when there is nothing to send
+     */
+    ISR(USART_UDRE_vect){
+        serial_on_UDR_empty();
+    }
+
     /**
      * @brief Interrupt routine for ICCM RX pin (INT0)
      * Rising edge on RX pin triggers sampling of RX pin signal. Routine will read defined number of bits equal to the size of data frame. 
@@ -0,0 +1,16 @@
+#ifndef BATTERY_GUARD
+#define BATTERY_GUARD
+
+/*! @file battery.h
+    @brief API for battery voltage measurement
+*/
+
+#include <stdint.h>
+
+void battery_on_ADC_sample(uint8_t arg, uint16_t adc_val);
+uint16_t battery_get_mV(void);
+uint8_t battery_get_correction(void);
+void battery_run(void);
+void battery_print(void);
+
+#endif /* BATTERY_GUARD */
@@ -0,0 +1,15 @@
+#ifndef BRAKE_TEST_GUARD
+#define BRAKE_TEST_GUARD
+
+/*! @file brake_test.h
+    @brief API for stopping distance measurement of brake modes
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+void brake_test_measure(char *stop_cmd);
+void brake_test_run(void);
+void brake_test_cbk(const void *data, size_t data_len);
+
+#endif /* BRAKE_TEST_GUARD */
@@ -11,6 +11,10 @@
 #define ICCM_TX PD3
 #define ICCM_DELAY_US 30
 
+/* Reverse thrust brake: length of full duty pulse against the motion when stopping from full duty (scaled down for lower duty).
+   MCU1 waits this long after sending MOTORS_STOP_REVERSE before the robot is at rest. */
+#define DRIVE_REVERSE_THRUST_MS 40
+
 #define COMMON_SERIAL_CMD_LIST \
 {"enbuff", serial_enable_buffering, NULL}, \
 {"disbuff", serial_disable_buffering, NULL}, \
@@ -19,24 +23,61 @@
 {"rdrx", serial_read_rx_buffer, NULL}, \
 {"clrrx", serial_clear_rx_buffer, NULL}, \
 {"iccmdis", ICCM_disable, NULL}, \
-{"iccmen", ICCM_enable, NULL}
+{"iccmen", ICCM_enable, NULL}, \
+{"txstat", serial_print_tx_stats, NULL}, \
+{"logbn", serial_benchmark_log, NULL}
 
 #ifdef MCU1
-    /* Line sensor pins*/
-    #define LS1 PD4
-    #define LS2 PD5
-    #define LS3 PD6
-    #define LS4 PD7
+    /* Line sensor topology, one row per sensor: X(name, pin, angle)
+       Pins must be on port D (all sensors are read at once), max 8 sensors. Angle is direction of the sensor seen from 
+       the centre of the robot in degrees: 0 - front, negative - left, positive - right, 180 - rear. */
+    #define LS_TOPOLOGY(X) \
+    X(LS1, PD4, -45) \
+    X(LS2, PD5, 45) \
+    X(LS3, PD6, 135) \
+    X(LS4, PD7, -135)
 
     /* AI init btn */
     #define MASTER_INIT PB1
 
-    /* distance sensor config */
-    #define DS1 PC0
-    #define DS2 PC1
+    /* Distance sensor topology, one row per sensor: X(name, pin, filter, window, angle)
+       Pins must be ADC inputs (port C), max 8 sensors. Filter is DS_FILTER_AVERAGE or DS_FILTER_MEDIAN, window is number of 
+       averaged samples (1, 2, 4 or 8). Angle is direction of sensor axis in degrees: 0 - straight ahead, negative - left, positive - right. 
+       Sensors are scanned by ADC in the listed order. */
+    #define DS_TOPOLOGY(X) \
+    X(DS1, PC0, DS_FILTER_MEDIAN, 4, -15) \
+    X(DS2, PC1, DS_FILTER_MEDIAN, 4, 15)
+    /* Measure DS noise floor during ARMED countdown (1 if nothing is in front of the robot at start position) */
+    #define DS_CALIBRATION_ON_ARM 0
+    /* Stop command sent when line is detected (MOTORS_STOP_COAST, MOTORS_STOP_BRAKE or MOTORS_STOP_REVERSE), see "brake" cmd */
+    #define LINE_BRAKE MOTORS_STOP_REVERSE
+
+    /* ADC sampling rate: F_CPU/ADC_PRESCALER/13 conversions per second, shared by all scanned channels.
+       128 -> ~9.6k conversions/s. Prescalers below 128 exceed 200kHz ADC clock and reduce accuracy. */
+    #define ADC_PRESCALER 128
+
+    /* Battery voltage divider: BATTERY_SENSE pin sees Vbat*R_BOTTOM/(R_TOP+R_BOTTOM), must stay below 2.56V */
+    #define BATTERY_SENSE PC2
+    #define BATTERY_DIVIDER_R_TOP 47        /* kOhm */
+    #define BATTERY_DIVIDER_R_BOTTOM 10     /* kOhm */
+    /* Voltage at which PWM levels were tuned, MCU2 scales PWM by BATTERY_NOMINAL_MV/Vbat */
+    #define BATTERY_NOMINAL_MV 7400
+
+    /* ADC scan list: {channel, decimation shift (sink gets average of 2^n conversions), sink, sink argument} */
+    #define ADC_SCAN_DS_ENTRY(name, pin, filter, window, angle) {CH_##name, 0, sensor_hub_on_DS_sample, name##_ID},
+    #define ADC_SCAN_LIST \
+    DS_TOPOLOGY(ADC_SCAN_DS_ENTRY) \
+    {CH_BATTERY, 6, battery_on_ADC_sample, 0}
 
     /* Cmds specific to MCU1*/
     #define MCU_SPECIFIC_SERIAL_CMD_LIST \
+    {"strat", NULL, strategy_set_cbk}, \
+    {"open", NULL, opening_book_set_cbk}, \
+    {"sens", sensor_hub_print, NULL}, \
+    {"batt", battery_print, NULL}, \
+    {"dscal", NULL, ds_calibration_cbk}, \
+    {"trim", NULL, trim_calibration_cbk}, \
+    {"brake", NULL, brake_test_cbk} \
 
 #endif
 
@@ -55,12 +96,24 @@
     #define M4_IN2 PB0
     #define M4_PWM PB1
 
+    /* Motor slew rate limit: max change of duty (0-255) per PWM period (2.04ms) */
+    #define DRIVE_ACCEL_STEP 8      /* 0 -> full in ~65ms */
+    #define DRIVE_DECEL_STEP 16     /* full -> 0 in ~33ms */
+    /* Kick-start: full duty burst when motor starts from rest or reverses, in ms per requested PWM level 
+       {20% and lower, 30%, 40%, 50%, 60%, 70%, 80%, 90%, 100%}, 0 - no burst (slew rate limited start). Tunable via drvks. */
+    #define DRIVE_KICK_START_MS {40, 30, 20, 10, 0, 0, 0, 0, 0}
+
     /* Cmds specific to MCU2*/
     #define MCU_SPECIFIC_SERIAL_CMD_LIST \
     {"drvinit", drive_ctrl_init, NULL}, \
     {"drvpwm", NULL, drive_ctrl_set_pwm_cbk}, \
+    {"drvdty", NULL, drive_ctrl_set_duty_cbk}, \
     {"drvctrl", NULL, drive_ctrl_set_movement_cbk}, \
-    {"drvtr", NULL, drive_ctrl_turn_right_cbk} \
+    {"drvtr", NULL, drive_ctrl_turn_right_cbk}, \
+    {"drvbat", drive_ctrl_print_PWM, NULL}, \
+    {"drvm", NULL, drive_ctrl_set_motor_cbk}, \
+    {"drvtm", NULL, drive_ctrl_trim_cbk}, \
+    {"drvks", NULL, drive_ctrl_kick_start_cbk} \
 
 #endif
 
@@ -4,13 +4,43 @@
 #include <stdint.h>
 #include "config.h"
 
+#define DS_ID_ENTRY(name, pin, filter, window, angle) name##_ID,
+
+/**
+ * @brief <name>_ID of every DS in DS_TOPOLOGY (config.h)
+ */
 typedef enum DS_ID_Tag{
-    DS1_ID = 0,
-    DS2_ID
+    DS_TOPOLOGY(DS_ID_ENTRY)
+    DS_NUM
 }DS_ID_T;
 
-void distance_sensor_read_ADC(DS_ID_T DS_ID, volatile uint16_t adc_val);
+/* Masks of sensors looking to the left/right of the robot axis (both include sensors looking straight ahead), resolved at compile time */
+#define DS_LEFT_BIT(name, pin, filter, window, angle)  | (((angle) <= 0) << name##_ID)
+#define DS_RIGHT_BIT(name, pin, filter, window, angle) | (((angle) >= 0) << name##_ID)
+#define DS_LEFT_MASK  (0 DS_TOPOLOGY(DS_LEFT_BIT))
+#define DS_RIGHT_MASK (0 DS_TOPOLOGY(DS_RIGHT_BIT))
+
+/**
+ * @brief Filter applied to DS samples, configured per sensor in config.h
+ */
+typedef enum DS_Filter_Tag{
+    DS_FILTER_AVERAGE = 0,  /* Moving average only */
+    DS_FILTER_MEDIAN        /* Median of DS_MEDIAN_SIZE last samples (spike rejection), then moving average */
+}DS_Filter_T;
+
+/**
+ * @brief Consistent view of all DS, taken atomically
+ */
+typedef struct DS_Snapshot_Tag{
+    uint16_t filtered[DS_NUM];
+    uint16_t raw[DS_NUM];
+}DS_Snapshot_T;
+
+void distance_sensor_read_ADC(DS_ID_T DS_ID, uint16_t adc_val);
 uint16_t distance_sensor_get_status(DS_ID_T DS_ID);
+uint16_t distance_sensor_get_distance_mm(DS_ID_T DS_ID);
+uint16_t distance_sensor_adc_to_mm(uint16_t adc_val);
+void distance_sensor_get_snapshot(DS_Snapshot_T *snapshot);
 void distance_sensor_init(void);
 
 #endif /* DISTANCE_SENSOR_GUARD */
@@ -7,8 +7,13 @@ void drive_ctrl_init(void);
 void drive_ctrl_PWM_processing(void);
 void drive_ctrl_run(void);
 void drive_ctrl_set_pwm_cbk(const void *data, size_t data_len);
+void drive_ctrl_set_duty_cbk(const void *data, size_t data_len);
 void drive_ctrl_set_movement_cbk(const void *data, size_t data_len);
 void drive_ctrl_turn_right_cbk(const void *data, size_t data_len);
+void drive_ctrl_set_motor_cbk(const void *data, size_t data_len);
+void drive_ctrl_kick_start_cbk(const void *data, size_t data_len);
+void drive_ctrl_trim_cbk(const void *data, size_t data_len);
+void drive_ctrl_print_PWM(void);
 #endif /* DRIVE_CONTROL_GUARD */
 
 
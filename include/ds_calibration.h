@@ -0,0 +1,20 @@
+#ifndef DS_CALIBRATION_GUARD
+#define DS_CALIBRATION_GUARD
+
+/*! @file ds_calibration.h
+    @brief API for distance sensor noise floor calibration
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "distance_sensor.h"
+
+void ds_calibration_init(void);
+void ds_calibration_measure(void);
+void ds_calibration_run(void);
+uint16_t ds_calibration_get_trigger_mm(DS_ID_T DS_ID);
+uint16_t ds_calibration_get_lock_mm(DS_ID_T DS_ID);
+void ds_calibration_print(void);
+void ds_calibration_cbk(const void *data, size_t data_len);
+
+#endif /* DS_CALIBRATION_GUARD */
@@ -7,7 +7,40 @@
 
 #include "config.h"
 #include <stdbool.h>
+#include <stdint.h>
 
-uint8_t line_sensor_get_status(); 
+#define LS_ID_ENTRY(name, pin, angle) name##_ID,
+
+/**
+ * @brief <name>_ID of every line sensor in LS_TOPOLOGY (config.h), also the bit number of sensor in line sensor masks
+ */
+typedef enum LS_ID_Tag{
+    LS_TOPOLOGY(LS_ID_ENTRY)
+    LS_NUM
+}LS_ID_T;
+
+/* Masks of sensors on the front/rear/left/right part of the robot, resolved at compile time */
+#define LS_FRONT_BIT(name, pin, angle) | (((angle) > -90 && (angle) < 90) << name##_ID)
+#define LS_REAR_BIT(name, pin, angle)  | (((angle) < -90 || (angle) > 90) << name##_ID)
+#define LS_LEFT_BIT(name, pin, angle)  | (((angle) < 0 && (angle) > -180) << name##_ID)
+#define LS_RIGHT_BIT(name, pin, angle) | (((angle) > 0 && (angle) < 180) << name##_ID)
+#define LS_FRONT_MASK (0 LS_TOPOLOGY(LS_FRONT_BIT))
+#define LS_REAR_MASK  (0 LS_TOPOLOGY(LS_REAR_BIT))
+#define LS_LEFT_MASK  (0 LS_TOPOLOGY(LS_LEFT_BIT))
+#define LS_RIGHT_MASK (0 LS_TOPOLOGY(LS_RIGHT_BIT))
+
+/**
+ * @brief Line sensor masks, bit <name>_ID describes sensor: 1(line detected) or 0(line NOT detected)
+ */
+typedef struct Line_Sensor_Status_Tag{
+    uint8_t current;            /* Debounced state of sensors */
+    uint8_t latched;            /* Sensors which detected line since the last acknowledge */
+    uint16_t edge_ms[LS_NUM];   /* Time of the latched detection (valid only for bits set in latched) */
+} Line_Sensor_Status_T;
+
+void line_sensor_init(void);
+void line_sensor_sample(void);
+Line_Sensor_Status_T line_sensor_get_status(void);
+void line_sensor_acknowledge(uint8_t mask);
 
 #endif /* LINE_SENSOR_GUARD */
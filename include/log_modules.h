@@ -0,0 +1,35 @@
+#ifndef LOG_MODULES_GUARD
+#define LOG_MODULES_GUARD
+
+/*! @file log_modules.h
+    @brief Modules which may log
+    Every source file with log sites defines LOG_MODULE (one of the IDs below) after its includes. Binary log ID of a log site is
+    LOG_MODULE << LOG_LINE_BITS | __LINE__, tools/gen_log_dict.py reads this list to map IDs back to files. Text logs print the file
+    name from this list (kept in flash, see serial_tx.c) as log source.
+    One row per source file: X(module ID, file). Position in the list is the module ID - new modules are appended, so logs recorded
+    with older builds still decode. Max 32 modules.
+*/
+
+#define LOG_MODULE_LIST(X) \
+X(LOG_MODULE_SERIAL_TX, "serial_tx.c") \
+X(LOG_MODULE_SERIAL_RX, "serial_rx.c") \
+X(LOG_MODULE_ICCM, "iccm.c") \
+X(LOG_MODULE_MCU1, "mcu1.c") \
+X(LOG_MODULE_MCU2, "mcu2.c") \
+X(LOG_MODULE_AI, "AI.c") \
+X(LOG_MODULE_STRATEGY, "strategy.c") \
+X(LOG_MODULE_OPENING_BOOK, "opening_book.c") \
+X(LOG_MODULE_SENSOR_HUB, "sensor_hub.c") \
+X(LOG_MODULE_BATTERY, "battery.c") \
+X(LOG_MODULE_DS_CALIBRATION, "ds_calibration.c") \
+X(LOG_MODULE_TRIM_CALIBRATION, "trim_calibration.c") \
+X(LOG_MODULE_BRAKE_TEST, "brake_test.c") \
+X(LOG_MODULE_DRIVE_CTRL, "drive_ctrl.c")
+
+#define LOG_MODULE_ENUM(id, file) id,
+typedef enum Log_Module_Tag{
+    LOG_MODULE_LIST(LOG_MODULE_ENUM)
+    LOG_MODULE_NUM
+} Log_Module_T;
+
+#endif /* LOG_MODULES_GUARD */
@@ -0,0 +1,39 @@
+#ifndef MANEUVER_GUARD
+#define MANEUVER_GUARD
+
+/*! @file maneuver.h
+    @brief API for non-blocking playback of timed motor command sequences
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MANEUVER_HOLD 0     /* Step duration meaning "keep this step until maneuver is stopped" */
+#define MANEUVER_MIN_PWM 20
+#define MANEUVER_MAX_PWM 100
+#define MANEUVER_MOTOR_NUM 4
+#define MANEUVER_QUEUE_MAX_STEPS 3      /* Steps in single MCU2 motion queue message */
+#define MANEUVER_QUEUE_MAX_MS 0xFFF     /* Max step duration in MCU2 motion queue */
+#define MANEUVER_TRIM_UNITY 256         /* Wheel trim of 1.0 */
+
+/**
+ * @brief Single step of a maneuver. Tables of steps are kept in PROGMEM and terminated with step which has cmd == NULL
+ */
+typedef struct Maneuver_Step_Tag{
+    char *cmd;              /* ICCM movement command (MOTORS_* from ICCM_message_catalog.h) */
+    uint8_t PWM;            /* PWM in range MANEUVER_MIN_PWM - MANEUVER_MAX_PWM */
+    uint16_t duration_ms;   /* Step duration or MANEUVER_HOLD */
+} Maneuver_Step_T;
+
+void maneuver_start(const Maneuver_Step_T *steps, bool loop);
+bool maneuver_run(void);
+void maneuver_stop(void);
+bool maneuver_is_running(const Maneuver_Step_T *steps);
+void maneuver_set_PWM(uint8_t PWM);
+void maneuver_set_duty(uint8_t duty);
+uint8_t maneuver_get_PWM(void);
+void maneuver_set_motors_PWM(const int8_t *PWM);
+void maneuver_send_queue(const Maneuver_Step_T *steps, uint8_t count);
+void maneuver_set_trims(const uint16_t *trims);
+
+#endif /* MANEUVER_GUARD */
@@ -0,0 +1,26 @@
+#ifndef OPENING_BOOK_GUARD
+#define OPENING_BOOK_GUARD
+
+/*! @file opening_book.h
+    @brief API for library of opening moves
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "maneuver.h"
+
+typedef enum Opening_ID_Tag{
+    OPENING_CHARGE = 0,
+    OPENING_SIDE_STEP_LEFT,
+    OPENING_SIDE_STEP_RIGHT,
+    OPENING_SPIN_AND_CHARGE,
+    OPENING_NUM
+} Opening_ID_T;
+
+void opening_book_select(Opening_ID_T id);
+Opening_ID_T opening_book_get_id(void);
+const Maneuver_Step_T* opening_book_get_script(void);
+void opening_book_print(void);
+void opening_book_set_cbk(const void *data, size_t data_len);
+
+#endif /* OPENING_BOOK_GUARD */
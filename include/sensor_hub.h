@@ -0,0 +1,29 @@
+#ifndef SENSOR_HUB_GUARD
+#define SENSOR_HUB_GUARD
+
+/*! @file sensor_hub.h
+    @brief API for coherent snapshots of all sensors
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "distance_sensor.h"
+#include "line_sensor.h"
+
+/**
+ * @brief View of all sensors taken at the same moment
+ */
+typedef struct Sensor_Snapshot_Tag{
+    uint16_t seq;                   /* Incremented with every published snapshot */
+    uint16_t timestamp_ms;          /* System tick time when DS sample set was completed */
+    uint16_t ds_filtered[DS_NUM];
+    uint16_t ds_raw[DS_NUM];
+    uint8_t ls_current;             /* Debounced line sensor mask */
+    uint8_t ls_latched;             /* Line detections latched since the last acknowledge */
+} Sensor_Snapshot_T;
+
+void sensor_hub_on_DS_sample(uint8_t DS_ID, uint16_t adc_val);
+void sensor_hub_get_snapshot(Sensor_Snapshot_T *snapshot);
+void sensor_hub_print(void);
+
+#endif /* SENSOR_HUB_GUARD */
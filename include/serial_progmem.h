@@ -23,11 +23,24 @@
         PROGMEM_AI_STATUS_ATTACK,
         PROGMEM_AI_STATUS_RETURN,
         PROGMEM_AI_FORCED_STOP,
-        PROGMEM_AI_INIT_IN
+        PROGMEM_AI_INIT_IN,
+        PROGMEM_STRATEGY_AGGRESSIVE,
+        PROGMEM_STRATEGY_COUNTER_PUNCHER,
+        PROGMEM_STRATEGY_EDGE_TRAPPER,
+        PROGMEM_STRATEGY_AUTO,
+        PROGMEM_AI_STATUS_OPENING,
+        PROGMEM_OPENING_CHARGE,
+        PROGMEM_OPENING_SIDE_STEP_LEFT,
+        PROGMEM_OPENING_SIDE_STEP_RIGHT,
+        PROGMEM_OPENING_SPIN_AND_CHARGE,
+        PROGMEM_DS_CALIBRATION_STARTED,
+        PROGMEM_DS_NOT_CALIBRATED,
+        PROGMEM_TRIM_CALIBRATION_STARTED,
+        PROGMEM_TRIM_CALIBRATION_NO_WALL,
+        PROGMEM_BRAKE_TEST_NO_WALL
     } Progmem_Table_Index_T;
 
     /* Global variables */
-    extern char data_conversion_buffer[];
     extern const char* const progmem_string_table[];
 
 #endif /* SERIAL_PROGMEM_GUARD */
@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <avr/pgmspace.h>
 #include <serial_progmem.h>
+#include "log_modules.h"
 
 /**
  * @brief Describes the type of log being send.
@@ -22,54 +23,96 @@ typedef enum Log_Type_Tag{
 } Log_Type_T;
 
 /**
- * @brief Structure describing the origin and type of log
+ * @brief Describes the origin and type of log, one per log site. Stored in flash (PROGMEM), passed by pointer.
  */
-typedef struct Log_Metadata_Tag{
-    const char *filename;
-    const uint32_t line_num;
-    const Log_Type_T log_type;
-} Log_Metadata_T;
+typedef struct Log_Site_Tag{
+    uint8_t module;         /* Log_Module_T, name of the module is printed as log source */
+    uint8_t log_type;       /* Log_Type_T */
+    uint16_t line_num;
+} Log_Site_T;
+
+/* Binary log record: LOG_SYNC_BYTE, log ID (2 bytes), arguments (PROGMEM string index - 1 byte, log_data_N arguments - 2 bytes,
+   4 bytes with 'l' modifier, strings null-terminated). Multi-byte values are little endian. Decoded by tools/log_decoder.py
+   with dictionary of log sites generated by tools/gen_log_dict.py. */
+#define LOG_SYNC_BYTE 0xA5
+#define LOG_LINE_BITS 11        /* Log sites must be in the first 2047 lines of a file */
+#define LOG_ID ((uint16_t)(((uint16_t)(LOG_MODULE) << LOG_LINE_BITS) | __LINE__))
 
 /** Logging API */
-#define copy_to_ram(id)     (strcpy_P(data_conversion_buffer, (char*)pgm_read_word(&progmem_string_table[(uint8_t)id])))
-#define get_metadata(type)  (Log_Metadata_T){__FILE__, __LINE__, type}
+#define get_progmem_string(id)  ((PGM_P)pgm_read_word(&progmem_string_table[(uint8_t)id]))
+/* Compile-time printf check of log_data_N arguments, the call is never executed */
+#define check_log_format(format, ...) (0 ? log_format_check(format, __VA_ARGS__) : (void)0)
+/* Defines descriptor of the log site in flash (log_site) in the enclosing block */
+#define LOG_SITE(type)          static const Log_Site_T log_site PROGMEM = {LOG_MODULE, type, __LINE__}
 
-#define log_info(str)   (serial_log( get_metadata(INFO), str ))
-#define log_info_P(id)  copy_to_ram(id); \
-                        serial_log(get_metadata(INFO), data_conversion_buffer)
-                          
-#define log_warn(str)   (serial_log( get_metadata(WARNING), str ))
-#define log_warn_P(id)  copy_to_ram(id); \
-                        serial_log(get_metadata(WARNING), data_conversion_buffer)
-#define log_err(str)    (serial_log( get_metadata(ERROR), str ))
-#define log_err_P(id)   copy_to_ram(id); \
-                        serial_log(get_metadata(ERROR), data_conversion_buffer)
+#ifndef LOG_BINARY
+/* PROGMEM strings are streamed from flash, log_data_N formats are kept in flash and formatted straight into TX ring (see format_data
+   in serial_tx.c for supported conversions) */
+#define log_info(str)   do{ LOG_SITE(INFO); serial_log(&log_site, str); } while(0)
+#define log_info_P(id)  do{ LOG_SITE(INFO); serial_log_P(&log_site, get_progmem_string(id)); } while(0)
+#define log_warn(str)   do{ LOG_SITE(WARNING); serial_log(&log_site, str); } while(0)
+#define log_warn_P(id)  do{ LOG_SITE(WARNING); serial_log_P(&log_site, get_progmem_string(id)); } while(0)
+#define log_err(str)    do{ LOG_SITE(ERROR); serial_log(&log_site, str); } while(0)
+#define log_err_P(id)   do{ LOG_SITE(ERROR); serial_log_P(&log_site, get_progmem_string(id)); } while(0)
 
 #define log_raw_string(str) serial_log_raw_string(str)
 
-#define log_data_1(format, arg1)                                            sprintf(data_conversion_buffer, format, arg1);\
-                                                                            serial_log(get_metadata(INFO), data_conversion_buffer)
-#define log_data_2(format, arg1, arg2)                                      sprintf(data_conversion_buffer, format, arg1, arg2);\
-                                                                            serial_log(get_metadata(INFO), data_conversion_buffer)
-#define log_data_3(format, arg1,arg2, arg3)                                 sprintf(data_conversion_buffer, format, arg1, arg2, arg3);\
-                                                                            serial_log(get_metadata(INFO), data_conversion_buffer)
-#define log_data_4(format, arg1, arg2, arg3, arg4)                          sprintf(data_conversion_buffer, format, arg1, arg2, arg3, arg4);\
-                                                                            serial_log(get_metadata(INFO), data_conversion_buffer)
-#define log_data_5(format, arg1, arg2, arg3, arg4, arg5)                    sprintf(data_conversion_buffer, format, arg1, arg2, arg3, arg4, arg5);\
-                                                                            serial_log(get_metadata(INFO), data_conversion_buffer)
-#define log_data_6(format, arg1, arg2, arg3, arg4, arg5, arg6)              sprintf(data_conversion_buffer, format, arg1, arg2, arg3, arg4, arg5, arg6);\
-                                                                            serial_log(get_metadata(INFO), data_conversion_buffer)
-#define log_data_7(format, arg1, arg2, arg3, arg4, arg5, arg6, arg7)        sprintf(data_conversion_buffer, format, arg1, arg2, arg3, arg4, arg5, arg6, arg7);\
-                                                                            serial_log(get_metadata(INFO), data_conversion_buffer)
-#define log_data_8(format, arg1, arg2, arg3, arg4, arg5,arg6, arg7, arg8)   sprintf(data_conversion_buffer, format, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8);\
-                                                                            serial_log(get_metadata(INFO), data_conversion_buffer)                                                                           
-                                   
+#define log_data(format, ...)   do{ \
+                                    LOG_SITE(INFO); \
+                                    check_log_format(format, __VA_ARGS__); \
+                                    serial_log_data(&log_site, PSTR(format), __VA_ARGS__); \
+                                } while(0)
+#define log_data_1(format, arg1)                                            log_data(format, arg1)
+#define log_data_2(format, arg1, arg2)                                      log_data(format, arg1, arg2)
+#define log_data_3(format, arg1,arg2, arg3)                                 log_data(format, arg1, arg2, arg3)
+#define log_data_4(format, arg1, arg2, arg3, arg4)                          log_data(format, arg1, arg2, arg3, arg4)
+#define log_data_5(format, arg1, arg2, arg3, arg4, arg5)                    log_data(format, arg1, arg2, arg3, arg4, arg5)
+#define log_data_6(format, arg1, arg2, arg3, arg4, arg5, arg6)              log_data(format, arg1, arg2, arg3, arg4, arg5, arg6)
+#define log_data_7(format, arg1, arg2, arg3, arg4, arg5, arg6, arg7)        log_data(format, arg1, arg2, arg3, arg4, arg5, arg6, arg7)
+#define log_data_8(format, arg1, arg2, arg3, arg4, arg5,arg6, arg7, arg8)   log_data(format, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8)
+#else
+/* Binary mode: strings are replaced with log ID (must be literals, their text is in the dictionary), log_data_N sends raw arguments */
+#define log_info(str)   ((void)sizeof("" str ""), serial_log_binary(LOG_ID))
+#define log_info_P(id)  serial_log_binary_P(LOG_ID, id)
+#define log_warn(str)   ((void)sizeof("" str ""), serial_log_binary(LOG_ID))
+#define log_warn_P(id)  serial_log_binary_P(LOG_ID, id)
+#define log_err(str)    ((void)sizeof("" str ""), serial_log_binary(LOG_ID))
+#define log_err_P(id)   serial_log_binary_P(LOG_ID, id)
+
+#define log_raw_string(str) ((void)sizeof("" str ""), serial_log_binary(LOG_ID))
+
+#define log_data_1(format, ...) (check_log_format(format, __VA_ARGS__), serial_log_binary_data(LOG_ID, PSTR(format), __VA_ARGS__))
+#define log_data_2(format, ...) (check_log_format(format, __VA_ARGS__), serial_log_binary_data(LOG_ID, PSTR(format), __VA_ARGS__))
+#define log_data_3(format, ...) (check_log_format(format, __VA_ARGS__), serial_log_binary_data(LOG_ID, PSTR(format), __VA_ARGS__))
+#define log_data_4(format, ...) (check_log_format(format, __VA_ARGS__), serial_log_binary_data(LOG_ID, PSTR(format), __VA_ARGS__))
+#define log_data_5(format, ...) (check_log_format(format, __VA_ARGS__), serial_log_binary_data(LOG_ID, PSTR(format), __VA_ARGS__))
+#define log_data_6(format, ...) (check_log_format(format, __VA_ARGS__), serial_log_binary_data(LOG_ID, PSTR(format), __VA_ARGS__))
+#define log_data_7(format, ...) (check_log_format(format, __VA_ARGS__), serial_log_binary_data(LOG_ID, PSTR(format), __VA_ARGS__))
+#define log_data_8(format, ...) (check_log_format(format, __VA_ARGS__), serial_log_binary_data(LOG_ID, PSTR(format), __VA_ARGS__))
+#endif /* LOG_BINARY */
+
 void serial_init(uint32_t f_cpu, uint32_t baudrate);
-void serial_log(const Log_Metadata_T metadata, const char *str);
+void serial_log(const Log_Site_T *site, const char *str);
+void serial_log_P(const Log_Site_T *site, PGM_P str);
+void serial_log_data(const Log_Site_T *site, PGM_P format, ...);
 bool serial_is_tx_buffer_full(void);
 void serial_disable_buffering(void);
 void serial_enable_buffering(void);
 void serial_read_tx_buffer(void);
 void serial_clear_tx_buffer(void);
 void serial_log_raw_string(const char *str);
+void serial_log_binary(uint16_t log_id);
+void serial_log_binary_P(uint16_t log_id, uint8_t progmem_id);
+void serial_log_binary_data(uint16_t log_id, PGM_P format, ...);
+void serial_send_char(const char c);
+void serial_on_UDR_empty(void);
+void serial_print_tx_stats(void);
+void serial_benchmark_log(void);
+
+/**
+ * @brief Empty function used only for printf format check of log_data_N arguments (check_log_format)
+ */
+static inline void __attribute__((format(printf, 1, 2))) log_format_check(const char *format, ...){
+    (void)format;
+}
 #endif /* SERIAL_TX_GUARD */
@@ -0,0 +1,41 @@
+#ifndef STRATEGY_GUARD
+#define STRATEGY_GUARD
+
+/*! @file strategy.h
+    @brief API for opponent classification and strategy profiles
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "AI.h"
+#include "maneuver.h"
+
+typedef enum Strategy_ID_Tag{
+    STRATEGY_AGGRESSIVE = 0,    /* Charge at full power, meant for slow or stationary opponents */
+    STRATEGY_COUNTER_PUNCHER,   /* Wait for fast opponent and side-step its attack */
+    STRATEGY_EDGE_TRAPPER,      /* Patient lock and steady push, meant for evasive opponents */
+    STRATEGY_NUM
+} Strategy_ID_T;
+
+/**
+ * @brief Decision thresholds of a profile, DS values are distances in millimetres
+ */
+typedef struct Strategy_Thresholds_Tag{
+    uint16_t ds_trigger_mm;         /* Any DS closer than this - start tracking */
+    uint16_t ds_lock_mm;            /* Both DS closer than this - target locked */
+    uint16_t ds_locked_range_mm;    /* Target tracked and left/right closest DS difference below this value - target centered and locked */
+    uint8_t tracking_PWM;
+    uint8_t tracking_pulse_ms;
+    uint8_t escape_PWM;
+} Strategy_Thresholds_T;
+
+void strategy_init(void);
+void strategy_update(uint16_t distance_mm, AI_Status_T AI_status);
+const Strategy_Thresholds_T* strategy_get_thresholds(void);
+const Maneuver_Step_T* strategy_get_search_maneuver(void);
+const Maneuver_Step_T* strategy_get_attack_maneuver(void);
+Strategy_ID_T strategy_get_id(void);
+void strategy_print(void);
+void strategy_set_cbk(const void *data, size_t data_len);
+
+#endif /* STRATEGY_GUARD */
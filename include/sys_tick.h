@@ -0,0 +1,15 @@
+#ifndef SYS_TICK_GUARD
+#define SYS_TICK_GUARD
+
+/*! @file sys_tick.h
+    @brief API for system time base
+*/
+
+#include <stdint.h>
+
+void sys_tick_init(void);
+void sys_tick_on_tick(void);
+uint16_t sys_tick_get_ms(void);
+uint16_t sys_tick_elapsed_ms(uint16_t since_ms);
+
+#endif /* SYS_TICK_GUARD */
@@ -0,0 +1,16 @@
+#ifndef TRIM_CALIBRATION_GUARD
+#define TRIM_CALIBRATION_GUARD
+
+/*! @file trim_calibration.h
+    @brief API for straight-line calibration of wheel trims
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+void trim_calibration_measure(void);
+void trim_calibration_run(void);
+void trim_calibration_print(void);
+void trim_calibration_cbk(const void *data, size_t data_len);
+
+#endif /* TRIM_CALIBRATION_GUARD */
@@ -1,33 +1,91 @@
 /*! @file ADC.c
     @brief Analog-Digital Converter
-    ADC conversion is triggered using TIMER0 (no Free-Running mode). This is to prevent choking of ICCM.
+    ADC works through the scan list (ADC_SCAN_LIST in config.h) in a loop, one conversion per entry. Every entry names the channel, 
+    decimation and the sink callback which receives the results - new analog inputs are added to the list only, ISR stays the same.
+    Decimated entry accumulates 2^n conversions and passes their average to the sink, so the sink is called at a lower rate with less noise.
+    Work done per conversion does not depend on the number of entries.
+    Conversions are chained: ADC ISR reads the result, immediately starts conversion of the next entry and only then processes
+    the result, so data processing overlaps with the next conversion. Sampling rate is set only by ADC_PRESCALER (see config.h):
+    F_CPU/ADC_PRESCALER/13 conversions per second, split evenly between the scan entries. No timer is used.
+    Free-Running mode (the only auto trigger of ATmega8) is not used, because it switches MUX one conversion late - any delayed ISR 
+    (e.g. ICCM reception) would silently swap the channels. Chained conversion is simply delayed instead.
 */
 
+#include <avr/io.h>
+#include <avr/pgmspace.h>
 #include "ADC.h"
 #include "config.h"
 #include "serial_tx.h"
+#include "distance_sensor.h"
+#include "sensor_hub.h"
+#include "battery.h"
 
-static void timer0_init(void){
-    /* Set timer clk source and prescaler(256) */
-    TCCR0 |= (1<<CS02)|(1<<CS00);
-    /* Enable timer0 overflow interrupt */
-    TIMSK |= (1<<TOIE0); 
+#if ADC_PRESCALER == 128
+    #define ADC_PRESCALER_BITS ((1<<ADPS2)|(1<<ADPS1)|(1<<ADPS0))
+#elif ADC_PRESCALER == 64
+    #define ADC_PRESCALER_BITS ((1<<ADPS2)|(1<<ADPS1))
+#elif ADC_PRESCALER == 32
+    #define ADC_PRESCALER_BITS ((1<<ADPS2)|(1<<ADPS0))
+#elif ADC_PRESCALER == 16
+    #define ADC_PRESCALER_BITS (1<<ADPS2)
+#else
+    #error "ADC_PRESCALER must be one of: 16, 32, 64, 128"
+#endif
+
+/**
+ * @brief Decimation state of scan entry
+ */
+typedef struct ADC_Scan_State_Tag{
+    uint16_t accumulator;
+    uint8_t count;
+}ADC_Scan_State_T;
+
+static const ADC_Scan_Entry_T ADC_SCAN_TABLE[] PROGMEM = {
+    ADC_SCAN_LIST
+};
+
+#define ADC_SCAN_LENGTH (sizeof(ADC_SCAN_TABLE)/sizeof(ADC_SCAN_TABLE[0]))
+
+static ADC_Scan_State_T scan_state[ADC_SCAN_LENGTH];
+static uint8_t current_entry = 0;
+
+/**
+ * @brief Selects channel and starts single conversion
+ */
+static void start_conversion(uint8_t entry){
+    ADMUX = pgm_read_byte(&ADC_SCAN_TABLE[entry].channel);
+    ADCSRA |= 1<<ADSC;
 }
 
 void ADC_init(void){
-    /* Set prescaler to 128 */
-    ADCSRA |= 1<<ADPS0 | 1<<ADPS1 | 1<<ADPS2;
-    /* Internal 2.56V voltage ref */
-    ADMUX |= (1<<REFS0);
-    /* Set ADC channel to match DS1 */
-    ADC_switch_channel(CH_DS1);
+    ADCSRA = ADC_PRESCALER_BITS;
     /* Enable interrupt on ADC conversion finished */
     ADCSRA |= 1<<ADIE;
     /* Enable ADC*/
     ADCSRA |= 1<<ADEN;
-    timer0_init();
+    /* Start the scan, following conversions are started from ISR */
+    current_entry = 0;
+    start_conversion(current_entry);
 } 
 
-void ADC_switch_channel(ADC_CHANNEL_ID_T channel_id){
-    ADMUX = (uint8_t)channel_id;
-}
\ No newline at end of file
+/**
+ * @brief Used in ADC ISR - starts conversion of the next scan entry and passes the result to the sink of the converted one
+ */
+void ADC_on_conversion_complete(void){
+    const uint16_t adc_val = ADCW;
+    const uint8_t converted_entry = current_entry;
+    ADC_Scan_State_T *state = &scan_state[converted_entry];
+
+    current_entry = (current_entry >= ADC_SCAN_LENGTH-1) ? 0 : current_entry+1;
+    start_conversion(current_entry);
+
+    const uint8_t decimation_shift = pgm_read_byte(&ADC_SCAN_TABLE[converted_entry].decimation_shift);
+    state->accumulator += adc_val;
+    state->count++;
+    if((state->count >> decimation_shift) != 0){
+        ADC_Sink_T sink = (ADC_Sink_T)pgm_read_word(&ADC_SCAN_TABLE[converted_entry].sink);
+        sink(pgm_read_byte(&ADC_SCAN_TABLE[converted_entry].sink_arg), state->accumulator >> decimation_shift);
+        state->accumulator = 0;
+        state->count = 0;
+    }
+}
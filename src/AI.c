@@ -11,6 +11,15 @@
 #include <util/delay.h>
 #include "distance_sensor.h"
 #include "line_sensor.h"
+#include "strategy.h"
+#include "maneuver.h"
+#include "opening_book.h"
+#include "sys_tick.h"
+#include "sensor_hub.h"
+#include "ds_calibration.h"
+#include <stdlib.h>
+
+#define LOG_MODULE LOG_MODULE_AI
 
 /* Disable debug logs if AI_DEBUG is not defined during build */
 #ifndef AI_DEBUG
@@ -30,41 +39,29 @@
     #define log_raw_string(str)
 #endif
 
-#define DS_TRIGGER_LEVEL_1 400
-#define DS_TRIGGER_LEVEL_2 700
-#define DS_LOCKED_RANGE 200
 #define INIT_DELAY_MS 1000
 #define FORCE_STOP_DELAY_MS 1000
-#define DEFAULT_PWM_VALUE 50
+#define BUTTON_DEBOUNCE_MS 50
+#define OPENING_SELECT_TIMEOUT_MS 1000  /* Time after last button press when AI gets armed */
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
 
+#define ESCAPE_DRIVE_OUT_MS 100         /* Time of driving away from the line before turning */
 
 static void stop(void);
-static void LS1_triggered(void);
-static void LS2_triggered(void);
-static void LS3_triggered(void);
-static void LS4_triggered(void);
-static void LS1_LS2_triggered(void);
-static void LS2_LS3_triggered(void);
-static void LS3_LS4_triggered(void);
-static void LS4_LS1_triggered(void);
+static void line_detected(void);
 static void DS_tracking(void);
 static void DS_target_locked(void);
 static void no_sensor_input(void);
 
 typedef enum AI_Vector_ID_Tag {
     UNKNOWN = 0,
-    LS1_TRIGGERED = 1,
-    LS2_TRIGGERED = 2,
-    LS3_TRIGGERED = 4,
-    LS4_TRIGGERED = 8,
-    LS1_LS2_TRIGGERED = 3,
-    LS2_LS3_TRIGGERED = 6,
-    LS3_LS4_TRIGGERED = 12,
-    LS4_LS1_TRIGGERED = 9,
-    DS_TRACKING = 20,
-    DS_TARGET_LOCKED = 21,
-    NO_SENSOR_INPUT = 22,
-    STOP = 22,
+    LINE_DETECTED,
+    DS_TRACKING,
+    DS_TARGET_LOCKED,
+    NO_SENSOR_INPUT,
+    STOP
 } AI_Vector_ID_T;
 
 typedef void (*Vector_Cbk)(void);
@@ -80,14 +77,7 @@ typedef struct Rotation_Adjustment_Record_Tag{
 }Rotation_Adjustment_Record_T;
 
 static const AI_Vector_T AI_VECTORS[] = {
-    {LS1_TRIGGERED, LS1_triggered},
-    {LS2_TRIGGERED, LS2_triggered},
-    {LS3_TRIGGERED, LS3_triggered},
-    {LS4_TRIGGERED, LS4_triggered},
-    {LS1_LS2_TRIGGERED, LS1_LS2_triggered},
-    {LS2_LS3_TRIGGERED, LS2_LS3_triggered},
-    {LS3_LS4_TRIGGERED, LS3_LS4_triggered},
-    {LS4_LS1_TRIGGERED, LS4_LS1_triggered},
+    {LINE_DETECTED, line_detected},
     {DS_TRACKING, DS_tracking},
     {DS_TARGET_LOCKED, DS_target_locked},
     {NO_SENSOR_INPUT, no_sensor_input},
@@ -115,14 +105,18 @@ static const Rotation_Adjustment_Record_T ROTATION_ADJUSTMENT_TABLE[] = {
 };
 
 static AI_Status_T AI_status = AI_IDLE;
-static uint8_t current_PWM = DEFAULT_PWM_VALUE;
+static uint8_t button_press_count = 0;
+static uint16_t last_button_press_ms = 0;
+static uint16_t last_sensor_seq = 0;
+static uint16_t decision_ds_mm[DS_NUM];    /* DS distances used by the current decision */
+static uint8_t decision_ls_mask = 0;        /* Line sensors used by the current decision */
 
 /**
- * @brief Get the rotation delay coresponding to current PWM value
+ * @brief Get the rotation delay coresponding to PWM value
  * @return uint16_t delay in milliseconds
  */
-static uint16_t get_rotation_delay(void){
-    return ROTATION_ADJUSTMENT_TABLE[current_PWM/10].rotation_time;
+static uint16_t get_rotation_delay(uint8_t PWM){
+    return ROTATION_ADJUSTMENT_TABLE[PWM/10].rotation_time;
 }
 
 /**
@@ -142,113 +136,145 @@ static void stop(void){
     ICCM_send(MOTORS_STOP);
 }
 
-static void LS1_triggered(void){
-    current_PWM = DEFAULT_PWM_VALUE;
-    ICCM_send(MOTORS_PWM_50);
-    ICCM_send(MOTORS_GO_BACKWARD);
-    _delay_ms(100);
-    ICCM_send(MOTORS_TURN_RIGHT);
-    variable_delay_ms(get_rotation_delay());
-}
-
-static void LS2_triggered(void){
-    current_PWM = DEFAULT_PWM_VALUE;
-    ICCM_send(MOTORS_PWM_50);
-    ICCM_send(MOTORS_GO_BACKWARD);
-    _delay_ms(100);
-    ICCM_send(MOTORS_TURN_LEFT);
-    variable_delay_ms(get_rotation_delay());
-}
-
-static void LS3_triggered(void){
-    current_PWM = DEFAULT_PWM_VALUE;
-    ICCM_send(MOTORS_PWM_50);
-    ICCM_send(MOTORS_GO_FORWARD);
-    _delay_ms(100);
-    ICCM_send(MOTORS_TURN_LEFT);
-    variable_delay_ms(get_rotation_delay());
-}
-
-static void LS4_triggered(void){
-    current_PWM = DEFAULT_PWM_VALUE;
-    ICCM_send(MOTORS_PWM_50);
-    ICCM_send(MOTORS_GO_FORWARD);
-    _delay_ms(100);
-    ICCM_send(MOTORS_TURN_RIGHT);
-    variable_delay_ms(get_rotation_delay());
-}
-
-static void LS1_LS2_triggered(void){
-    current_PWM = DEFAULT_PWM_VALUE;
-    ICCM_send(MOTORS_PWM_50);
-    ICCM_send(MOTORS_GO_BACKWARD);
-    _delay_ms(100);
-    ICCM_send(MOTORS_TURN_RIGHT);
-    variable_delay_ms(2*get_rotation_delay());
-}
-
-static void LS2_LS3_triggered(void){
-    current_PWM = DEFAULT_PWM_VALUE;
-    ICCM_send(MOTORS_PWM_50);
-    ICCM_send(MOTORS_TURN_LEFT);
-    variable_delay_ms(get_rotation_delay());
+/**
+ * @brief Escapes from the line, using line sensor positions from LS_TOPOLOGY
+ * Robot drives away from the end (front/rear) which detected the line, then turns away from the side which detected it.
+ * Line on both sides of one end: turns around after backing off the front, drives straight out at the rear.
+ * Line on both ends: only turns (robot is parallel to the line or across it).
+ * Whole escape is sent to MCU2 motion queue as a single message and timed there, AI waits until it is finished.
+ */
+static void line_detected(void){
+    const bool front = (decision_ls_mask & LS_FRONT_MASK) != 0;
+    const bool rear = (decision_ls_mask & LS_REAR_MASK) != 0;
+    const bool left = (decision_ls_mask & LS_LEFT_MASK) != 0;
+    const bool right = (decision_ls_mask & LS_RIGHT_MASK) != 0;
+    const uint8_t PWM = strategy_get_thresholds()->escape_PWM;
+    Maneuver_Step_T escape[2];
+    uint8_t steps = 0;
+    uint16_t escape_ms = 0;
+    uint8_t rotations = 0;
+
+    if(left != right){
+        rotations = 1;
+    } else if(left && right && (front || !rear)){
+        rotations = 2;
+    }
+    if(front != rear){
+        escape[steps] = (Maneuver_Step_T){front ? MOTORS_GO_BACKWARD : MOTORS_GO_FORWARD, PWM, ESCAPE_DRIVE_OUT_MS};
+        escape_ms += escape[steps++].duration_ms;
+    }
+    if(rotations > 0){
+        escape[steps] = (Maneuver_Step_T){(right && !left) ? MOTORS_TURN_LEFT : MOTORS_TURN_RIGHT, PWM, rotations*get_rotation_delay(PWM)};
+        escape_ms += escape[steps++].duration_ms;
+    }
+    maneuver_stop();
+    /* Stop hard before escaping, MCU2 starts the escape queue once the robot is braked */
+    ICCM_send(LINE_BRAKE);
+    if(steps > 0){
+        maneuver_send_queue(escape, steps);
+    }
+    variable_delay_ms(DRIVE_REVERSE_THRUST_MS + escape_ms);
 }
 
-static void LS3_LS4_triggered(void){
-    current_PWM = DEFAULT_PWM_VALUE;
-    ICCM_send(MOTORS_PWM_50);
-    ICCM_send(MOTORS_GO_FORWARD);
+/**
+ * @brief Finds the closest DS reading on the left and on the right side of robot axis (DS_LEFT_MASK/DS_RIGHT_MASK)
+ */
+static void get_side_distances(const uint16_t *ds_mm, uint16_t *left_mm, uint16_t *right_mm){
+    *left_mm = UINT16_MAX;
+    *right_mm = UINT16_MAX;
+    for(uint8_t i = 0; i < DS_NUM; i++){
+        if((DS_LEFT_MASK & (1<<i)) && ds_mm[i] < *left_mm){
+            *left_mm = ds_mm[i];
+        }
+        if((DS_RIGHT_MASK & (1<<i)) && ds_mm[i] < *right_mm){
+            *right_mm = ds_mm[i];
+        }
+    }
 }
 
-static void LS4_LS1_triggered(void){
-    current_PWM = DEFAULT_PWM_VALUE;
-    ICCM_send(MOTORS_PWM_50);
-    ICCM_send(MOTORS_TURN_RIGHT);
-    variable_delay_ms(get_rotation_delay());
+/**
+ * @brief Returns distance of the closest DS reading
+ */
+static uint16_t get_closest_distance(const uint16_t *ds_mm){
+    uint16_t result = UINT16_MAX;
+    for(uint8_t i = 0; i < DS_NUM; i++){
+        result = MIN(result, ds_mm[i]);
+    }
+    return result;
 }
 
 static void DS_tracking(void){
-    uint16_t DS1_reading = distance_sensor_get_status(DS1_ID);
-    uint16_t DS2_reading = distance_sensor_get_status(DS2_ID);
-    // log_data_2("DS1=%d DS2=%d",DS1_reading, DS2_reading);
-    if(DS1_reading < DS2_reading){
-        ICCM_send(MOTORS_PWM_50);
+    const Strategy_Thresholds_T *thresholds = strategy_get_thresholds();
+    uint16_t left_mm, right_mm;
+    get_side_distances(decision_ds_mm, &left_mm, &right_mm);
+    maneuver_stop();
+    maneuver_set_PWM(thresholds->tracking_PWM);
+    /* Target is on the side of the closer sensor */
+    if(left_mm > right_mm){
         ICCM_send(MOTORS_TURN_RIGHT);
-        _delay_ms(2);
-        ICCM_send(MOTORS_STOP);
     } else {
-        ICCM_send(MOTORS_PWM_50);
         ICCM_send(MOTORS_TURN_LEFT);
-        _delay_ms(2);
-        ICCM_send(MOTORS_STOP);
     }
+    variable_delay_ms(thresholds->tracking_pulse_ms);
+    ICCM_send(MOTORS_STOP);
 }
 
 static void DS_target_locked(void){
-    ICCM_send(MOTORS_PWM_100);
-    ICCM_send(MOTORS_GO_FORWARD);
+    const Maneuver_Step_T *attack = strategy_get_attack_maneuver();
+    if(maneuver_is_running(attack)){
+        maneuver_run();
+    } else {
+        maneuver_start(attack, false);
+    }
 }
 
 static void no_sensor_input(void){
-    ICCM_send(MOTORS_PWM_50);
-    ICCM_send(MOTORS_GO_FORWARD);
+    const Maneuver_Step_T *search = strategy_get_search_maneuver();
+    if(maneuver_is_running(search)){
+        maneuver_run();
+    } else {
+        maneuver_start(search, true);
+    }
 }
 
-static uint16_t abs(uint16_t val){
-    if(val < 0){
-        val *= -1;
+static bool check_target_tracked(const uint16_t *ds_mm){
+    const Strategy_Thresholds_T *thresholds = strategy_get_thresholds();
+    for(uint8_t i = 0; i < DS_NUM; i++){
+        if(ds_mm[i] < MIN(thresholds->ds_trigger_mm, ds_calibration_get_trigger_mm((DS_ID_T)i))){
+            return true;
+        }
     }
-    return val;
+    return false;
 }
 
-static bool check_target_locked(uint16_t ds1_reading, uint16_t ds2_reading){
-    return ((ds1_reading >= DS_TRIGGER_LEVEL_2 && ds2_reading >= DS_TRIGGER_LEVEL_2) || (abs( (int16_t)ds1_reading - (int16_t)ds2_reading) < DS_LOCKED_RANGE));
+/**
+ * @brief Target is locked when all DS see it close or when it is tracked and seen at similar distance on both sides of robot axis
+ */
+static bool check_target_locked(const uint16_t *ds_mm){
+    const Strategy_Thresholds_T *thresholds = strategy_get_thresholds();
+    bool all_close = true;
+    for(uint8_t i = 0; i < DS_NUM; i++){
+        if(ds_mm[i] > MIN(thresholds->ds_lock_mm, ds_calibration_get_lock_mm((DS_ID_T)i))){
+            all_close = false;
+            break;
+        }
+    }
+    if(all_close){
+        return true;
+    }
+    uint16_t left_mm, right_mm;
+    get_side_distances(ds_mm, &left_mm, &right_mm);
+    if(left_mm == UINT16_MAX || right_mm == UINT16_MAX){
+        return false;   /* Side without sensor or reading, target can't be centered */
+    }
+    const uint16_t diff_mm = (left_mm > right_mm) ? left_mm - right_mm : right_mm - left_mm;
+    return (check_target_tracked(ds_mm) && diff_mm < thresholds->ds_locked_range_mm);
 }
 /**********************************************************************
 * Determining the vector 
 ***********************************************************************/
 static AI_Vector_T get_vector_by_ID(AI_Vector_ID_T id){
-    AI_Vector_T result = AI_VECTORS[11];
+    AI_Vector_T result = {STOP, stop};
     for(uint8_t i = 0; i<arr_length(AI_VECTORS); i++){
         if(AI_VECTORS[i].id == id){
             result = AI_VECTORS[i];
@@ -258,16 +284,18 @@ static AI_Vector_T get_vector_by_ID(AI_Vector_ID_T id){
     return result;
 }
 
-static AI_Vector_T calculate_vector(uint8_t ls_reading, uint16_t ds1_reading, uint16_t ds2_reading){
-    AI_Vector_T result = get_vector_by_ID((AI_Vector_ID_T)ls_reading);
-    // AI_Vector_T result = {UNKNOWN, NULL};
+static AI_Vector_T calculate_vector(uint8_t ls_reading, const uint16_t *ds_mm){
+    AI_Vector_T result = {UNKNOWN, NULL};
     AI_Status_T previous_AI_status = AI_status;
 
-    if(result.id == UNKNOWN){
-        if(check_target_locked(ds1_reading, ds2_reading)){
+    if(ls_reading != 0){
+        result = get_vector_by_ID(LINE_DETECTED);
+        AI_status = AI_RETURN;
+    } else {
+        if(check_target_locked(ds_mm)){
             result = get_vector_by_ID(DS_TARGET_LOCKED);
             AI_status = AI_ATTACK;
-        } else if(ds1_reading > DS_TRIGGER_LEVEL_1 || ds2_reading > DS_TRIGGER_LEVEL_1){
+        } else if(check_target_tracked(ds_mm)){
             result = get_vector_by_ID(DS_TRACKING);
             AI_status = AI_TRACKING;
         } else {
@@ -275,8 +303,6 @@ static AI_Vector_T calculate_vector(uint8_t ls_reading, uint16_t ds1_reading, ui
             log_info("no input");
             AI_status = AI_SEARCH;
         }
-    } else {
-        AI_status = AI_RETURN;
     }
 
     if(previous_AI_status != AI_status){
@@ -286,6 +312,70 @@ static AI_Vector_T calculate_vector(uint8_t ls_reading, uint16_t ds1_reading, ui
     return result;
 }
 
+/**
+ * @brief Checks if sensor hub has published a new snapshot since the last decision
+ */
+static bool is_new_snapshot_available(const Sensor_Snapshot_T *snapshot){
+    if(snapshot->seq != last_sensor_seq){
+        last_sensor_seq = snapshot->seq;
+        return true;
+    }
+    return false;
+}
+
+/**********************************************************************
+* Opening and button handling 
+***********************************************************************/
+/**
+ * @brief Plays the opening move until it ends or any sensor fires, then hands over to regular decision-making
+ */
+static void continue_opening(uint8_t ls_reading, const uint16_t *ds_mm){
+    bool sensor_fired = (ls_reading != 0) || check_target_tracked(ds_mm);
+    if(sensor_fired || !maneuver_run()){
+        maneuver_stop();
+        AI_status = AI_SEARCH;
+        print_AI_status();
+    }
+}
+
+/**
+ * @brief Returns true once per button press (falling edge on MASTER_INIT, debounced)
+ */
+static bool is_button_pressed(void){
+    static bool was_pressed = false;
+    bool pressed = ((PINB & (1<<MASTER_INIT)) == 0);
+    bool result = false;
+    if(pressed && !was_pressed && sys_tick_elapsed_ms(last_button_press_ms) >= BUTTON_DEBOUNCE_MS){
+        last_button_press_ms = sys_tick_get_ms();
+        result = true;
+    }
+    was_pressed = pressed;
+    return result;
+}
+
+/**
+ * @brief Start/Stop AI with MASTER_INIT button
+ * In IDLE, presses are counted and AI gets armed OPENING_SELECT_TIMEOUT_MS after the last one. Single press keeps selected opening,
+ * N presses select opening (N-1) modulo OPENING_NUM. In any other status single press stops the AI.
+ */
+static void process_button(void){
+    bool pressed = is_button_pressed();
+    if(AI_get_status() == AI_IDLE){
+        if(pressed){
+            button_press_count++;
+        } else if(button_press_count > 0 && sys_tick_elapsed_ms(last_button_press_ms) >= OPENING_SELECT_TIMEOUT_MS){
+            if(button_press_count > 1){
+                opening_book_select((Opening_ID_T)((button_press_count-1) % OPENING_NUM));
+            }
+            button_press_count = 0;
+            AI_init();
+        }
+    } else if(pressed){
+        AI_force_stop();
+        print_AI_status();
+    }
+}
+
 /**********************************************************************
 * Public functions 
 ***********************************************************************/
@@ -297,6 +387,9 @@ void print_AI_status(void){
         case AI_ARMED:
             log_info_P(PROGMEM_AI_STATUS_ARMED);
             break;
+        case AI_OPENING:
+            log_info_P(PROGMEM_AI_STATUS_OPENING);
+            break;
         case AI_TRACKING:
             log_info_P(PROGMEM_AI_STATUS_TRACKING);
         case AI_SEARCH:
@@ -319,29 +412,34 @@ AI_Status_T AI_get_status(void){
 }
 
 void AI_run(void){
-    /* Read button to Start/Stop AI */
-    if((PINB & (1<<MASTER_INIT)) == 0){
-        if(AI_get_status() == AI_IDLE){
-            AI_init();
-        } else {
-            AI_force_stop();
-            print_AI_status();
-        }
-    }
+    Sensor_Snapshot_T sensors;
+    process_button();
     /* Process AI status */
     switch (AI_get_status()){
+        case AI_OPENING:
         case AI_SEARCH:
         case AI_ATTACK:
         case AI_RETURN:
         case AI_TRACKING:
-            /* Blank statement to allow definition after label */;
-            uint16_t DS1_reading = distance_sensor_get_status(DS1_ID);
-            uint16_t DS2_reading = distance_sensor_get_status(DS2_ID);
-            // log_data_2("DS1=%d DS2=%d",DS1_reading, DS2_reading);
-            uint8_t LS_readings = line_sensor_get_status();
-            const AI_Vector_T vect = calculate_vector(LS_readings, DS1_reading, DS2_reading);
-            vect.cbk();
-            _delay_ms(5);
+            /* Exactly one decision per fresh sensor snapshot */
+            sensor_hub_get_snapshot(&sensors);
+            if(!is_new_snapshot_available(&sensors)){
+                break;
+            }
+            for(uint8_t i = 0; i < DS_NUM; i++){
+                decision_ds_mm[i] = distance_sensor_adc_to_mm(sensors.ds_filtered[i]);
+            }
+            /* Latched detections are consumed by this decision */
+            line_sensor_acknowledge(sensors.ls_latched);
+            decision_ls_mask = sensors.ls_current | sensors.ls_latched;
+            if(AI_status == AI_OPENING){
+                continue_opening(decision_ls_mask, decision_ds_mm);
+            }
+            if(AI_status != AI_OPENING){
+                const AI_Vector_T vect = calculate_vector(decision_ls_mask, decision_ds_mm);
+                vect.cbk();
+                strategy_update(get_closest_distance(decision_ds_mm), AI_status);
+            }
             break;
         case AI_IDLE:
         case AI_ARMED:
@@ -357,7 +455,12 @@ void AI_init(void){
     log_info_P(PROGMEM_AI_STATUS_ARMED);
     log_info_P(PROGMEM_AI_INIT_IN);
     log_raw_string("5..\n");
+#if DS_CALIBRATION_ON_ARM
+    /* Takes the same time as one countdown step */
+    ds_calibration_measure();
+#else
     _delay_ms(INIT_DELAY_MS);
+#endif
     log_raw_string("4..\n");
     _delay_ms(INIT_DELAY_MS);
     log_raw_string("3..\n");
@@ -366,13 +469,15 @@ void AI_init(void){
     _delay_ms(INIT_DELAY_MS);
     log_raw_string("1..\n");
     _delay_ms(INIT_DELAY_MS);
-    log_info_P(PROGMEM_AI_STATUS_SEARCH);
-    AI_status = AI_SEARCH;
-    ICCM_send(MOTORS_GO_FORWARD);
-    ICCM_send(MOTORS_PWM_50);
+    strategy_init();
+    AI_status = AI_OPENING;
+    print_AI_status();
+    opening_book_print();
+    maneuver_start(opening_book_get_script(), false);
 }
 
 void AI_force_stop(void){
+    maneuver_stop();
     get_vector_by_ID(STOP).cbk();
     AI_status = AI_IDLE;
     log_info_P(PROGMEM_AI_FORCED_STOP);
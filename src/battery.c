@@ -0,0 +1,97 @@
+/*! @file battery.c
+    @brief Battery voltage measurement
+    Battery voltage is measured via resistor divider (BATTERY_DIVIDER_* in config.h) connected to BATTERY_SENSE pin. 
+    Samples are delivered by ADC scan, already averaged by ADC decimation.
+    All PWM levels (and rotation timings based on them) are tuned at BATTERY_NOMINAL_MV. To keep effective motor voltage constant,
+    MCU2 scales every PWM by correction factor BATTERY_NOMINAL_MV/Vbat, sent by this module over ICCM whenever it changes.
+*/
+
+#include <stdlib.h>
+#include <util/atomic.h>
+#include "config.h"
+#include "serial_tx.h"
+#include "ICCM.h"
+#include "ICCM_message_catalog.h"
+#include "ADC.h"
+#include "sys_tick.h"
+#include "battery.h"
+
+#define LOG_MODULE LOG_MODULE_BATTERY
+
+#define CORRECTION_UPDATE_PERIOD_MS 500
+#define CORRECTION_HYSTERESIS 2         /* percent, avoids resending when voltage oscillates around step boundary */
+#define CORRECTION_MSG_SIZE 5           /* "V" + up to 3 digits + null */
+
+static uint16_t battery_adc_val = 0;
+static uint8_t sent_correction = BATTERY_CORRECTION_NONE;
+static uint16_t last_update_ms = 0;
+
+/**
+ * @brief Sends PWM correction factor to MCU2
+ * @param correction Correction in percent
+ */
+static void send_correction(uint8_t correction){
+    char msg[CORRECTION_MSG_SIZE] = MOTORS_BATTERY_CORRECTION;
+    utoa(correction, msg + sizeof(MOTORS_BATTERY_CORRECTION)-1, 10);
+    ICCM_send(msg);
+    sent_correction = correction;
+}
+
+/**
+ * @brief ADC sink of battery channel, used in ADC ISR
+ */
+void battery_on_ADC_sample(uint8_t arg, uint16_t adc_val){
+    battery_adc_val = adc_val;
+}
+
+/**
+ * @brief Returns battery voltage in millivolts
+ */
+uint16_t battery_get_mV(void){
+    uint16_t adc_val;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        adc_val = battery_adc_val;
+    }
+    return (uint16_t)((uint32_t)adc_val * ADC_REFERENCE_MV * (BATTERY_DIVIDER_R_TOP + BATTERY_DIVIDER_R_BOTTOM) 
+                      / ((uint32_t)ADC_RESOLUTION * BATTERY_DIVIDER_R_BOTTOM));
+}
+
+/**
+ * @brief Returns PWM correction factor in percent (BATTERY_NOMINAL_MV/Vbat), limited to BATTERY_CORRECTION_MIN - BATTERY_CORRECTION_MAX
+ */
+uint8_t battery_get_correction(void){
+    const uint16_t battery_mV = battery_get_mV();
+    if(battery_mV == 0){
+        /* No measurement yet */
+        return BATTERY_CORRECTION_NONE;
+    }
+    const uint16_t correction = (uint16_t)((uint32_t)BATTERY_NOMINAL_MV * 100 / battery_mV);
+    if(correction < BATTERY_CORRECTION_MIN){
+        return BATTERY_CORRECTION_MIN;
+    }
+    if(correction > BATTERY_CORRECTION_MAX){
+        return BATTERY_CORRECTION_MAX;
+    }
+    return (uint8_t)correction;
+}
+
+/**
+ * @brief Periodically sends updated PWM correction to MCU2, called from main loop
+ */
+void battery_run(void){
+    if(sys_tick_elapsed_ms(last_update_ms) < CORRECTION_UPDATE_PERIOD_MS){
+        return;
+    }
+    last_update_ms = sys_tick_get_ms();
+    const uint8_t correction = battery_get_correction();
+    if(correction >= sent_correction + CORRECTION_HYSTERESIS || correction + CORRECTION_HYSTERESIS <= sent_correction){
+        send_correction(correction);
+    }
+}
+
+/**
+ * @brief Prints battery voltage and PWM correction via serial (debug)
+ */
+void battery_print(void){
+    log_data_2("Battery: %umV corr=%u%%", battery_get_mV(), sent_correction);
+}
@@ -0,0 +1,125 @@
+/*! @file brake_test.c
+    @brief Stopping distance measurement of MCU2 brake modes
+    Robot is placed facing a wall, drives towards it with BRAKE_TEST_PWM and sends the stop command with tested brake mode once the closest
+    DS reading drops to BRAKE_TEST_BRAKE_MM. Stopping distance is the difference between that reading and the closest one seen afterwards,
+    stopping time is measured until the last DS reading which got closer. Both contain DS filter lag (the same for all modes).
+    Test is started via serial command and executed from main loop while AI is IDLE.
+*/
+
+#include <stdbool.h>
+#include "config.h"
+#include "serial_tx.h"
+#include "sys_tick.h"
+#include "sensor_hub.h"
+#include "maneuver.h"
+#include "ICCM.h"
+#include "ICCM_message_catalog.h"
+#include "AI.h"
+#include "brake_test.h"
+
+#define LOG_MODULE LOG_MODULE_BRAKE_TEST
+
+#define BRAKE_TEST_PWM 100
+#define BRAKE_TEST_BRAKE_MM 300         /* Distance from the wall at which the stop is sent */
+#define BRAKE_TEST_RUN_UP_MM 250        /* Min. distance driven before braking */
+#define BRAKE_TEST_MAX_START_MM 800     /* Wall has to be visible from the start position */
+#define BRAKE_TEST_TIMEOUT_MS 2000
+#define BRAKE_TEST_SETTLE_MS 1000
+#define BRAKE_CMD_ARGUMENT_OFFSET 6
+
+static volatile char requested_mode = '\0';
+
+/**********************************************************************
+* Static functions
+***********************************************************************/
+/**
+ * @brief Returns the closest distance seen by any DS in current snapshot
+ */
+static uint16_t get_closest_mm(void){
+    Sensor_Snapshot_T sensors;
+    uint16_t result = UINT16_MAX;
+    sensor_hub_get_snapshot(&sensors);
+    for(uint8_t i = 0; i < DS_NUM; i++){
+        const uint16_t distance_mm = distance_sensor_adc_to_mm(sensors.ds_filtered[i]);
+        result = (distance_mm < result) ? distance_mm : result;
+    }
+    return result;
+}
+
+/**********************************************************************
+* Public functions
+***********************************************************************/
+/**
+ * @brief Measures stopping distance and time of brake mode, robot has to face a wall. Blocks for up to ~3s.
+ * @param stop_cmd MOTORS_STOP_COAST, MOTORS_STOP_BRAKE or MOTORS_STOP_REVERSE
+ */
+void brake_test_measure(char *stop_cmd){
+    uint16_t start_ms;
+    uint16_t brake_mm = get_closest_mm();
+    uint16_t closest_mm;
+    uint16_t stop_time_ms = 0;
+
+    if(brake_mm > BRAKE_TEST_MAX_START_MM || brake_mm < BRAKE_TEST_BRAKE_MM + BRAKE_TEST_RUN_UP_MM){
+        log_info_P(PROGMEM_BRAKE_TEST_NO_WALL);
+        return;
+    }
+    maneuver_set_PWM(BRAKE_TEST_PWM);
+    ICCM_send(MOTORS_GO_FORWARD);
+    start_ms = sys_tick_get_ms();
+    while((brake_mm = get_closest_mm()) > BRAKE_TEST_BRAKE_MM){
+        if(sys_tick_elapsed_ms(start_ms) >= BRAKE_TEST_TIMEOUT_MS){
+            ICCM_send(MOTORS_STOP_BRAKE);
+            log_info_P(PROGMEM_BRAKE_TEST_NO_WALL);
+            return;
+        }
+    }
+    ICCM_send(stop_cmd);
+    start_ms = sys_tick_get_ms();
+    closest_mm = brake_mm;
+    while(sys_tick_elapsed_ms(start_ms) < BRAKE_TEST_SETTLE_MS){
+        const uint16_t distance_mm = get_closest_mm();
+        if(distance_mm < closest_mm){
+            closest_mm = distance_mm;
+            stop_time_ms = sys_tick_elapsed_ms(start_ms);
+        }
+    }
+    log_data_3("Brake %s: %umm %ums", stop_cmd, brake_mm - closest_mm, stop_time_ms);
+}
+
+/**
+ * @brief Executes test requested via serial, called from main loop. Ignored unless AI is IDLE.
+ */
+void brake_test_run(void){
+    const char mode = requested_mode;
+    if(mode == '\0'){
+        return;
+    }
+    requested_mode = '\0';
+    if(AI_get_status() != AI_IDLE){
+        return;
+    }
+    switch (mode){
+    case 'c':
+        brake_test_measure(MOTORS_STOP_COAST);
+        break;
+    case 'b':
+        brake_test_measure(MOTORS_STOP_BRAKE);
+        break;
+    case 'r':
+        brake_test_measure(MOTORS_STOP_REVERSE);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Debug callbacks */
+/**
+ * @brief Serial command: "brake c/b/r" measures stopping distance of coast, short brake or reverse thrust (robot facing a wall)
+ */
+void brake_test_cbk(const void *data, size_t data_len){
+    if(data_len > BRAKE_CMD_ARGUMENT_OFFSET){
+        /* Serial callbacks run in ISR, test is done in main loop */
+        requested_mode = ((const char*)data)[BRAKE_CMD_ARGUMENT_OFFSET];
+    }
+}
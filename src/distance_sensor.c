@@ -1,69 +1,145 @@
 /*! @file distance_sensor.c
     @brief This module handles the data from ADC output, stores it and performs calculations on them. 
-    Data comes from two distance sensors (DS). It is read via ADC and stored in buffers separate for each DS. 
-    Other modules may request to read the average of the data samples - this is meant as a form of basic "debauncing" to avoid erratic behavior on invalid data.
+    Data comes from distance sensors (DS) listed in DS_TOPOLOGY (config.h). It is read via ADC and filtered in ADC ISR, separately for each DS. 
+    Filter type and window are configured per sensor in the topology table:
+    - optional median of DS_MEDIAN_SIZE last samples rejects single-sample spikes,
+    - moving average over window of 2^n samples is kept as a running sum, so every update costs the same regardless of the window.
+    Filtered value is ready when the ISR ends, readers only copy it (atomically, 16-bit values can't be read in one instruction on AVR).
+    Readings are converted to millimetres with a PROGMEM lookup table generated at build time from calibration/ds_calibration.csv 
+    (see tools/gen_ds_lut.py) and linear interpolation between table entries.
+    Complete sets of samples are published to other modules by sensor_hub.c.
 */
 
+#include <util/atomic.h>
 #include "distance_sensor.h"
 #include "serial_tx.h"
+#include "ds_lut.h"
 
-#define MAX_NUM_SAMPLES 5
+#define DS_MEDIAN_SIZE 3
+#define ADC_MAX_VALUE 1023
+#define DS_MAX_WINDOW 8
+#define WINDOW_SHIFT(w) (((w) >= 8) ? 3 : ((w) >= 4) ? 2 : ((w) >= 2) ? 1 : 0)
 
 /* Local macro-like functions */
 #define SB(x) (1<<(x))          /* set bit   */
 #define CB(x) (~(1<<(x)))       /* clear bit */
 
 typedef struct Distance_Sensor_Tag{
-    uint16_t samples[MAX_NUM_SAMPLES];
-    uint8_t num_samples_stored;
-    uint16_t *sample_ptr;
+    const uint8_t pin;
+    const DS_Filter_T filter;
+    const uint8_t window_shift;             /* Moving average over 2^window_shift samples */
+    uint16_t window[DS_MAX_WINDOW];
+    uint8_t window_idx;
+    uint16_t sum;                           /* Sum of samples in window */
+    uint16_t median_buff[DS_MEDIAN_SIZE];
+    uint8_t median_idx;
+    uint16_t filtered;
+    uint16_t raw;
 } Distance_Sensor_T;
 
+/* Window must be a power of 2 (it is applied as a shift), WINDOW_SHIFT would silently round other values down */
+#define DS_WINDOW_CHECK(name, pin, filter, window, angle) \
+    _Static_assert((window) >= 1 && (window) <= DS_MAX_WINDOW && ((window) & ((window)-1)) == 0, \
+                   "DS_TOPOLOGY: window of " #name " must be 1, 2, 4 or 8");
+DS_TOPOLOGY(DS_WINDOW_CHECK)
+
 /* DS array */
-static Distance_Sensor_T ds_sensors[] = {
-    {{0}, 0, NULL},
-    {{0}, 0, NULL}
+#define DS_RECORD(name, pin, filter, window, angle) {pin, filter, WINDOW_SHIFT(window)},
+static Distance_Sensor_T ds_sensors[DS_NUM] = {
+    DS_TOPOLOGY(DS_RECORD)
 }; 
 
 /**********************************************************************
 * Static functions 
 ***********************************************************************/
-static uint16_t getAvg(const uint16_t *samples, uint8_t num_samples_stored){
-    uint16_t result = 0;
-    for(uint8_t i=0; i<num_samples_stored; i++){
-        result += samples[i];
+/**
+ * @brief Returns median of DS_MEDIAN_SIZE samples (insertion sort of a local copy)
+ */
+static uint16_t get_median(const uint16_t *samples){
+    uint16_t sorted[DS_MEDIAN_SIZE];
+    for(uint8_t i = 0; i < DS_MEDIAN_SIZE; i++){
+        uint16_t sample = samples[i];
+        uint8_t j = i;
+        while(j > 0 && sorted[j-1] > sample){
+            sorted[j] = sorted[j-1];
+            j--;
+        }
+        sorted[j] = sample;
     }
-    return result/(uint16_t)num_samples_stored;
+    return sorted[DS_MEDIAN_SIZE/2];
 }
 
 /**********************************************************************
 * Public functions 
 ***********************************************************************/
-void distance_sensor_read_ADC(DS_ID_T DS_ID, volatile uint16_t adc_val){
+/**
+ * @brief Used in ADC ISR (via sensor hub) to store and filter a new sample
+ */
+void distance_sensor_read_ADC(DS_ID_T DS_ID, uint16_t adc_val){
     Distance_Sensor_T *current_ds = &ds_sensors[DS_ID];
+    uint16_t sample = adc_val;
+
+    current_ds->raw = adc_val;
+    if(current_ds->filter == DS_FILTER_MEDIAN){
+        current_ds->median_buff[current_ds->median_idx] = adc_val;
+        current_ds->median_idx = (current_ds->median_idx >= DS_MEDIAN_SIZE-1) ? 0 : current_ds->median_idx+1;
+        sample = get_median(current_ds->median_buff);
+    }
 
-    *(current_ds->sample_ptr) = adc_val;
+    current_ds->sum += sample - current_ds->window[current_ds->window_idx];
+    current_ds->window[current_ds->window_idx] = sample;
+    current_ds->window_idx = (current_ds->window_idx+1) & ((1<<current_ds->window_shift)-1);
+    current_ds->filtered = current_ds->sum >> current_ds->window_shift;
+}
 
-    if(current_ds->sample_ptr == &(current_ds->samples[MAX_NUM_SAMPLES-1])){
-        current_ds->sample_ptr = current_ds->samples;
-    } else {
-        current_ds->sample_ptr++;
+/**
+ * @brief Returns filtered value of single DS
+ */
+uint16_t distance_sensor_get_status(DS_ID_T DS_ID){
+    uint16_t result;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        result = ds_sensors[DS_ID].filtered;
     }
+    return result;
+}
 
-    if(current_ds->num_samples_stored < MAX_NUM_SAMPLES){
-        current_ds->num_samples_stored++;
+/**
+ * @brief Returns filtered value of single DS converted to millimetres
+ */
+uint16_t distance_sensor_get_distance_mm(DS_ID_T DS_ID){
+    return distance_sensor_adc_to_mm(distance_sensor_get_status(DS_ID));
+}
+
+/**
+ * @brief Converts ADC reading to distance in millimetres
+ * Table holds distance for every 2^DS_LUT_SHIFT ADC counts, reading is interpolated between neighbouring entries (distance decreases with reading).
+ */
+uint16_t distance_sensor_adc_to_mm(uint16_t adc_val){
+    if(adc_val > ADC_MAX_VALUE){
+        adc_val = ADC_MAX_VALUE;
     }
+    uint8_t idx = adc_val >> DS_LUT_SHIFT;
+    uint8_t fraction = adc_val & ((1<<DS_LUT_SHIFT)-1);
+    uint16_t mm_low = pgm_read_word(&DS_LUT_MM[idx]);
+    uint16_t mm_high = pgm_read_word(&DS_LUT_MM[idx+1]);
+    return mm_low - (uint16_t)(((mm_low - mm_high) * fraction) >> DS_LUT_SHIFT);
 }
 
-uint16_t distance_sensor_get_status(DS_ID_T DS_ID){
-    return getAvg(ds_sensors[DS_ID].samples, ds_sensors[DS_ID].num_samples_stored);
+/**
+ * @brief Copies filtered and raw values of all DS in one atomic step
+ */
+void distance_sensor_get_snapshot(DS_Snapshot_T *snapshot){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        for(uint8_t i = 0; i < DS_NUM; i++){
+            snapshot->filtered[i] = ds_sensors[i].filtered;
+            snapshot->raw[i] = ds_sensors[i].raw;
+        }
+    }
 }
 
 void distance_sensor_init(void){
     /* Set DS pins as input */
-    DDRC &= CB(DS1);
-    DDRC &= CB(DS2);
-    /* Initialize sample_ptrs */
-    ds_sensors[DS1_ID].sample_ptr = ds_sensors[DS1_ID].samples;
-    ds_sensors[DS2_ID].sample_ptr = ds_sensors[DS2_ID].samples;
-}
\ No newline at end of file
+    for(uint8_t i = 0; i < DS_NUM; i++){
+        DDRC &= CB(ds_sensors[i].pin);
+    }
+}
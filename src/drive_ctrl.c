@@ -4,10 +4,38 @@
 *   |1 2|
 *   |4 3|
 *
-*   @note PWM control works in range of 20% - 100% with step every 10%. Values below 20% are insufficient for turning around, therefore should not be used.
+*   @note Motors are controlled with 8-bit duty (0-255). PWM commands in percent (PWM_xx messages, drvpwm, drvm) are converted to duty.
+*         Values below 20% are insufficient for turning around, therefore should not be used.
+*   @note Requested PWM is scaled by battery correction received from MCU1, so effective motor voltage does not depend on battery charge.
+*         PWM saturates at 100% - with deeply discharged battery highest PWM levels can't be compensated.
+*   @note Every motor has its own signed PWM. Output duty follows requested value with slew rate limit (DRIVE_ACCEL_STEP and
+*         DRIVE_DECEL_STEP in config.h, applied once per PWM period), change of direction ramps down to 0 first, so wheels don't slip.
+*         Robot movements (forward, turn...) set direction of every motor with common PWM, ICCM and debug commands can set motors separately.
+*   @note Timed movements are executed from motion queue: every primitive (movement, duty, duration) is started exactly when the previous 
+*         one expires (system tick), so MCU1 sends a complete maneuver in a single ICCM message. Motors stop when the queue runs empty.
+*         Any direct movement command cancels the queue.
+*   @note Motor starting from rest (or reversing, which passes through 0) gets a kick-start: full duty for the time configured 
+*         for the requested PWM level (DRIVE_KICK_START_MS in config.h), then it drops straight to the requested duty. Low PWM 
+*         movements start reliably and quickly, levels with 0 ms start with slew rate limit.
+*   @note Stop command selects the brake mode: coast (IN1=IN2=low, motors spin out), short brake (IN1=IN2=high, motor windings shorted)
+*         or reverse thrust (full duty against the motion for up to DRIVE_REVERSE_THRUST_MS, then short brake). Braking bypasses
+*         the slew rate limit. Motion queue waits until reverse thrust ends, so an escape maneuver may be sent right after the stop.
+*   @note Every wheel has a trim (duty multiplier, TRIM_UNITY = 1.0) compensating motor-to-motor differences, so "forward" drives straight.
+*         Trims are stored in EEPROM, set by MCU1 straight-line calibration (ICCM) or drvtm debug command. They are applied together with 
+*         battery correction when target duty is computed, BCM images already contain trimmed duty - no extra work in ISR.
+*   @note PWM is generated with binary code modulation (BCM): the PWM period is split into 8 slots,
+*         slot of bit n lasts 2^n time units. During the slot PWM pins output bit n of the duty. Port images of every slot are computed
+*         whenever PWM changes, so Timer0 ISR (8 per period instead of one per PWM step) only writes three precomputed images and reloads 
+*         the timer. Unit = 2 timer ticks (8us), period = 255 units = 2.04ms (~490Hz).
+*   @note Images contain direction (IN1/IN2) pins too. Main loop never writes motor pins, it prepares the next state of all motors
+*         in a staging set of images, ISR switches to it at the start of the next PWM period. Directions and duties of all motors change 
+*         at once, wheels are never driven half-updated against each other.
 *   @note Functions ended with _cbk suffix are for debugging only!
 */
 #include <avr/io.h>
+#include <avr/eeprom.h>
+#include <util/atomic.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -16,157 +44,816 @@
 #include "serial_tx.h"
 #include "ICCM.h"
 #include "ICCM_message_catalog.h"
-#include <util/delay.h>
+#include "sys_tick.h"
+
+#define LOG_MODULE LOG_MODULE_DRIVE_CTRL
 
 #define CB(x) (~(1<<x))
 #define SB(x) (1<<x)
-#define ENABLE_M1_PWM() (PORTC|=SB(M1_PWM))
-#define ENABLE_M2_PWM() (PORTC|=SB(M2_PWM))
-#define ENABLE_M3_PWM() (PORTD|=SB(M3_PWM))
-#define ENABLE_M4_PWM() (PORTB|=SB(M4_PWM))
-#define DISABLE_M1_PWM() (PORTC&=CB(M1_PWM))
-#define DISABLE_M2_PWM() (PORTC&=CB(M2_PWM))
-#define DISABLE_M3_PWM() (PORTD&=CB(M3_PWM))
-#define DISABLE_M4_PWM() (PORTB&=CB(M4_PWM))
-#define MAX_INT_CNT 100
-#define MAX_PWM MAX_INT_CNT
-#define TCNT0_INITIAL 254
+/* PWM and direction pins of all motors, per port */
+#define MOTOR_MASK_B (SB(M4_PWM)|SB(M4_IN2))
+#define MOTOR_MASK_C (SB(M1_PWM)|SB(M1_IN1)|SB(M1_IN2)|SB(M2_PWM)|SB(M2_IN1)|SB(M2_IN2))
+#define MOTOR_MASK_D (SB(M3_PWM)|SB(M3_IN1)|SB(M3_IN2)|SB(M4_IN1))
+#define MAX_PWM 100
+#define MAX_DUTY 255
+#define PWM_TO_DUTY(pwm) ((uint16_t)(pwm) * MAX_DUTY / MAX_PWM)
+#define DUTY_TO_PWM(duty) (((uint16_t)(duty) * MAX_PWM + MAX_DUTY/2) / MAX_DUTY)   /* Rounded, inverse of PWM_TO_DUTY */
+#define PWM_TO_LEVEL(duty) (DUTY_TO_PWM(duty) / 10)                               /* Duty to PWM in tens of percent */
+#define PWM_BITS 8
 #define DRVPWM_CMD_ARGUMENT_OFFSET 7
+#define DRVDTY_CMD_ARGUMENT_OFFSET 7
 #define DRVTR_ARGUMENT_OFFSET 6
+#define DRVCTRL_ARGUMENT_OFFSET 8
+#define DRVM_MOTOR_ARGUMENT_OFFSET 5
+#define DRVM_PWM_ARGUMENT_OFFSET 7
 #define ASCII_NUM_OFFSET 48
+#define DRIVE_CTRL_RX_BUFFER_SIZE 20        /* Same as ICCM rx buffer */
+#define DUTY_ARG_LENGTH 2                   /* 2 hex digits, e.g. 80 */
+#define DURATION_ARG_LENGTH 3               /* 3 hex digits, e.g. 064 */
+#define MOTION_ARG_LENGTH (1+DUTY_ARG_LENGTH+DURATION_ARG_LENGTH)
+#define MOTION_QUEUE_SIZE 8
+#define MOTOR_DUTY_ARG_LENGTH 3             /* Sign and 2 hex digits, e.g. +80 */
+#define PWM_PERIOD_US 2040
+#define MS_TO_PWM_PERIODS(ms) (((uint32_t)(ms) * 1000 + PWM_PERIOD_US - 1) / PWM_PERIOD_US)
+#define KICK_START_MIN_LEVEL 2              /* First entry of kick-start table is for 20% and lower */
+#define KICK_START_LEVELS 9                 /* 20%, 30%, ..., 100% */
+#define DRVKS_LEVEL_ARGUMENT_OFFSET 6
+#define DRVKS_TIME_ARGUMENT_OFFSET 8
+#define TRIM_ARG_LENGTH 3                   /* 3 hex digits, e.g. 100 */
+#define TRIM_UNITY 256                      /* Trim of 1.0 */
+#define TRIM_MIN 128                        /* Trim can't slow wheel down below 50% */
+#define TRIM_MAGIC (0xA0 | MOTOR_NUM)
+#define DRVTM_MOTOR_ARGUMENT_OFFSET 6
+#define DRVTM_TRIM_ARGUMENT_OFFSET 8
+#define DEBUG_CMD_BUFFER_SIZE 12            /* Same as serial rx buffer */
+
+/**
+ * @brief Port images of single BCM slot
+ */
+typedef struct PWM_Slot_Tag{
+    uint8_t port_b;
+    uint8_t port_c;
+    uint8_t port_d;
+} PWM_Slot_T;
+
+typedef enum Motor_ID_Tag{
+    M1_ID = 0,
+    M2_ID,
+    M3_ID,
+    M4_ID,
+    MOTOR_NUM
+} Motor_ID_T;
+
+typedef enum Motor_Port_Tag{
+    MOTOR_PORT_B = 0,
+    MOTOR_PORT_C,
+    MOTOR_PORT_D,
+    MOTOR_PORT_NUM
+} Motor_Port_T;
+
+/**
+ * @brief State of motor driver bridge (TB6612FNG), set by IN1/IN2 pins
+ */
+typedef enum Motor_Direction_Tag{
+    DIRECTION_COAST = 0,    /* IN1 low, IN2 low */
+    DIRECTION_CW,           /* IN1 high, IN2 low */
+    DIRECTION_CCW,          /* IN1 low, IN2 high */
+    DIRECTION_BRAKE         /* IN1 high, IN2 high */
+} Motor_Direction_T;
+
+/**
+ * @brief State of single motor. Duty is signed: positive - CW, negative - CCW.
+ */
+typedef struct Motor_Tag{
+    const Motor_Port_T PWM_port;
+    const uint8_t PWM_mask;
+    const Motor_Port_T IN1_port;
+    const uint8_t IN1_mask;
+    const Motor_Port_T IN2_port;
+    const uint8_t IN2_mask;
+    Motor_Direction_T direction;
+    int16_t requested_duty;     /* Duty at nominal battery voltage */
+    int16_t target_duty;        /* Requested duty after battery correction */
+    int16_t duty;               /* Output duty, follows target with slew rate limit */
+    uint8_t kick_periods;       /* Remaining PWM periods of kick-start */
+} Motor_T;
+
+/**
+ * @brief Single timed movement executed from motion queue
+ */
+typedef struct Motion_Primitive_Tag{
+    char movement;          /* MOTORS_GO_FORWARD, MOTORS_TURN_RIGHT... */
+    uint8_t duty;
+    uint16_t duration_ms;
+} Motion_Primitive_T;
+
+/**
+ * @brief Wheel trims, stored in EEPROM
+ */
+/**
+ * @brief Debug cmd handler, called from main loop with a copy of the received cmd
+ */
+typedef void (*Debug_Cmd_Handler_T)(const char *cmd, uint8_t cmd_len);
 
-static uint8_t PWM = 80;
+typedef struct Trim_Record_Tag{
+    uint8_t magic;
+    uint16_t trim[MOTOR_NUM];
+} Trim_Record_T;
+
+/* Timer0 preload giving slot of bit n length of 2^(n+1) ticks */
+static const uint8_t SLOT_PRELOAD[PWM_BITS] = {
+    (uint8_t)(256-2), (uint8_t)(256-4), (uint8_t)(256-8), (uint8_t)(256-16), 
+    (uint8_t)(256-32), (uint8_t)(256-64), (uint8_t)(256-128), (uint8_t)(256-256)
+};
+
+/* Motor directions of robot movements */
+static const int8_t FORWARD[MOTOR_NUM]    = {1, 1, 1, 1};
+static const int8_t BACKWARD[MOTOR_NUM]   = {-1, -1, -1, -1};
+static const int8_t TURN_RIGHT[MOTOR_NUM] = {1, -1, -1, 1};
+static const int8_t TURN_LEFT[MOTOR_NUM]  = {-1, 1, 1, -1};
+static const int8_t STOP[MOTOR_NUM]       = {0, 0, 0, 0};
+
+
+static Motor_T motors[MOTOR_NUM] = {
+    {MOTOR_PORT_C, SB(M1_PWM), MOTOR_PORT_C, SB(M1_IN1), MOTOR_PORT_C, SB(M1_IN2)},
+    {MOTOR_PORT_C, SB(M2_PWM), MOTOR_PORT_C, SB(M2_IN1), MOTOR_PORT_C, SB(M2_IN2)},
+    {MOTOR_PORT_D, SB(M3_PWM), MOTOR_PORT_D, SB(M3_IN1), MOTOR_PORT_D, SB(M3_IN2)},
+    {MOTOR_PORT_B, SB(M4_PWM), MOTOR_PORT_D, SB(M4_IN1), MOTOR_PORT_B, SB(M4_IN2)}
+};
+
+static uint8_t kick_start_ms[KICK_START_LEVELS] = DRIVE_KICK_START_MS;
+static uint8_t requested_duty = PWM_TO_DUTY(80);
+static uint8_t battery_correction = BATTERY_CORRECTION_NONE;
+static Trim_Record_T EEMEM stored_trims;
+static uint16_t trims[MOTOR_NUM] = {TRIM_UNITY, TRIM_UNITY, TRIM_UNITY, TRIM_UNITY};
+static bool PWM_enabled = false;
+static PWM_Slot_T PWM_states[2][PWM_BITS];    /* Active and staging set of slot images */
+static volatile uint8_t active_state = 0;
+static volatile bool next_state_pending = false;
+static uint8_t current_slot = 0;
+static volatile uint8_t PWM_periods = 0;
+static Motion_Primitive_T motion_queue[MOTION_QUEUE_SIZE];
+static uint8_t motion_queue_head = 0;
+static uint8_t motion_queue_count = 0;
+static bool motion_active = false;
+static uint16_t motion_start_ms = 0;
+static uint16_t motion_duration_ms = 0;
+static bool reverse_thrust_active = false;
+static uint16_t reverse_thrust_start_ms = 0;
+static uint16_t reverse_thrust_duration_ms = 0;
+static volatile bool turn_requested = false;       /* drvtr cmd, serial callbacks run in ISR, queue is used in main loop */
+static volatile uint16_t turn_request_ms = 0;
+static volatile Debug_Cmd_Handler_T debug_cmd_handler = NULL;   /* drv* debug cmds, applied in main loop like drvtr */
+static char debug_cmd[DEBUG_CMD_BUFFER_SIZE];
+static uint8_t debug_cmd_len = 0;
 
 static void timer0_init(void){
-    /* Set timer clk source and prescaler(256) */
-    TCCR0 |= (1<<CS02); 
+    /* Set timer clk source and prescaler(64) - 4us tick */
+    TCCR0 = (1<<CS01)|(1<<CS00); 
     /* Enable timer0 overflow interrupt */
     TIMSK |= (1<<TOIE0); 
 }
 
 /**
- * Set of functions to control the direction (CW or CCW) of every wheel
+ * @brief Computes port images of all BCM slots for current direction and duty of every motor. Images are prepared in the staging set,
+ * ISR starts using them at the beginning of the next PWM period.
  */
-static void wheel_1_cw(void){
-    PORTC |= SB(M1_IN1);
-    PORTC &= CB(M1_IN2);
+static void update_PWM_slots(void){
+    uint8_t direction_ports[MOTOR_PORT_NUM] = {0, 0, 0};
+    /* ISR can't switch sets while the staging one is being written */
+    next_state_pending = false;
+    PWM_Slot_T *slots = PWM_states[active_state ^ 1];
+
+    for(uint8_t i = 0; i < MOTOR_NUM; i++){
+        const Motor_T *motor = &motors[i];
+        if(motor->direction == DIRECTION_CW || motor->direction == DIRECTION_BRAKE){
+            direction_ports[motor->IN1_port] |= motor->IN1_mask;
+        }
+        if(motor->direction == DIRECTION_CCW || motor->direction == DIRECTION_BRAKE){
+            direction_ports[motor->IN2_port] |= motor->IN2_mask;
+        }
+    }
+    for(uint8_t bit = 0; bit < PWM_BITS; bit++){
+        uint8_t ports[MOTOR_PORT_NUM] = {direction_ports[MOTOR_PORT_B], direction_ports[MOTOR_PORT_C], direction_ports[MOTOR_PORT_D]};
+        for(uint8_t i = 0; i < MOTOR_NUM; i++){
+            const uint8_t duty = PWM_enabled ? abs(motors[i].duty) : 0;
+            if(duty & SB(bit)){
+                ports[motors[i].PWM_port] |= motors[i].PWM_mask;
+            }
+        }
+        slots[bit].port_b = ports[MOTOR_PORT_B];
+        slots[bit].port_c = ports[MOTOR_PORT_C];
+        slots[bit].port_d = ports[MOTOR_PORT_D];
+    }
+    next_state_pending = true;
 }
 
-static void wheel_1_ccw(void){
-    PORTC &= CB(M1_IN1);
-    PORTC |= SB(M1_IN2);
+/**
+ * @brief Converts requested duty of every motor to target duty, including battery correction and wheel trim
+ */
+static void update_targets(void){
+    for(uint8_t i = 0; i < MOTOR_NUM; i++){
+        int32_t duty = (int32_t)motors[i].requested_duty * battery_correction * trims[i] / (BATTERY_CORRECTION_NONE * TRIM_UNITY);
+        if(duty > MAX_DUTY){
+            duty = MAX_DUTY;
+        } else if(duty < -MAX_DUTY){
+            duty = -MAX_DUTY;
+        }
+        motors[i].target_duty = (int16_t)duty;
+    }
 }
 
-static void wheel_2_cw(void){
-    PORTC |= SB(M2_IN1);
-    PORTC &= CB(M2_IN2);
+/**
+ * @brief Sets direction of every motor, magnitude is the common requested duty
+ * @param directions 1 (CW), -1 (CCW) or 0 (stop) for every motor
+ */
+static void set_motion(const int8_t *directions){
+    reverse_thrust_active = false;
+    for(uint8_t i = 0; i < MOTOR_NUM; i++){
+        motors[i].requested_duty = directions[i] * (int16_t)requested_duty;
+    }
+    update_targets();
 }
 
-static void wheel_2_ccw(void){
-    PORTC &= CB(M2_IN1);
-    PORTC |= SB(M2_IN2);
+/* Set of functions to combine wheel movements into robot movement*/
+static void stop(void){
+    set_motion(STOP);
 }
 
-static void wheel_3_cw(void){
-    PORTD |= SB(M3_IN1);
-    PORTD &= CB(M3_IN2);
+static void go_forward(void){
+    set_motion(FORWARD);
 }
 
-static void wheel_3_ccw(void){
-    PORTD &= CB(M3_IN1);
-    PORTD |= SB(M3_IN2);
+static void go_backward(void){
+    set_motion(BACKWARD);
 }
 
-static void wheel_4_cw(void){
-    PORTD |= SB(M4_IN1);
-    PORTB &= CB(M4_IN2);
+static void turn_right(void){
+    set_motion(TURN_RIGHT);
 }
 
-static void wheel_4_ccw(void){
-    PORTD &= CB(M4_IN1);
-    PORTB |= SB(M4_IN2);
+static void turn_left(void){
+    set_motion(TURN_LEFT);
 }
 
-/* Set of functions to combine wheel movements into robot movement*/
-static void stop(void){
-    PORTC &= CB(M1_IN1);
-    PORTC &= CB(M1_IN2);
-    PORTC &= CB(M2_IN1);
-    PORTC &= CB(M2_IN2);
-    PORTD &= CB(M3_IN1);
-    PORTD &= CB(M3_IN2);
-    PORTD &= CB(M4_IN1);
-    PORTB &= CB(M4_IN2);
+/**
+ * @brief Executes robot movement command
+ * @param movement MOTORS_GO_FORWARD, MOTORS_GO_BACKWARD, MOTORS_TURN_RIGHT, MOTORS_TURN_LEFT or MOTORS_STOP
+ * @return false if @movement is unknown
+ */
+static bool set_movement(char movement){
+    switch (movement){
+    case MOTORS_GO_FORWARD:
+        go_forward();
+        break;
+    case MOTORS_GO_BACKWARD:
+        go_backward();
+        break;
+    case MOTORS_TURN_RIGHT:
+        turn_right();
+        break;
+    case MOTORS_TURN_LEFT:
+        turn_left();
+        break;
+    case MOTORS_STOP:
+        stop();
+        break;
+    default:
+        return false;
+    }
+    return true;
 }
 
-static void go_forward(void){
-    wheel_1_cw();
-    wheel_2_cw();
-    wheel_3_cw();
-    wheel_4_cw();
+/**
+ * @brief Sets duty of all moving motors, keeps their directions
+ * @param duty Requested duty at nominal battery voltage
+ */
+static void set_duty(const uint8_t duty){
+    requested_duty = duty;
+    for(uint8_t i = 0; i < MOTOR_NUM; i++){
+        if(motors[i].requested_duty > 0){
+            motors[i].requested_duty = requested_duty;
+        } else if(motors[i].requested_duty < 0){
+            motors[i].requested_duty = -(int16_t)requested_duty;
+        }
+    }
+    update_targets();
 }
 
-static void go_backward(void){
-    wheel_1_ccw();
-    wheel_2_ccw();
-    wheel_3_ccw();
-    wheel_4_ccw();
+/**
+ * @brief Sets PWM of all moving motors in percent, keeps their directions
+ */
+static void set_PWM(const uint8_t pwm){
+    set_duty(PWM_TO_DUTY((pwm > MAX_PWM)?MAX_PWM:pwm));
 }
 
-static void turn_right(void){
-    wheel_1_cw();
-    wheel_2_ccw();
-    wheel_3_ccw();
-    wheel_4_cw();
+/**
+ * @brief Sets signed duty of single motor
+ * @param id Motor
+ * @param duty Requested duty at nominal battery voltage, positive - CW, negative - CCW
+ */
+static void set_motor_duty(Motor_ID_T id, int16_t duty){
+    if(duty > MAX_DUTY){
+        duty = MAX_DUTY;
+    } else if(duty < -MAX_DUTY){
+        duty = -MAX_DUTY;
+    }
+    reverse_thrust_active = false;
+    motors[id].requested_duty = duty;
+    update_targets();
 }
 
-static void turn_left(void){
-    wheel_1_ccw();
-    wheel_2_cw();
-    wheel_3_cw();
-    wheel_4_ccw();
+/**
+ * @brief Parses unsigned decimal number
+ * @param str Digits (not null-terminated)
+ * @param len Number of digits
+ * @param value Parsed value
+ * @return false if @str contains anything but digits
+ */
+static bool parse_decimal(const char *str, uint8_t len, uint16_t *value){
+    *value = 0;
+    for(uint8_t i = 0; i < len; i++){
+        if(str[i] < '0' || str[i] > '9'){
+            return false;
+        }
+        *value = *value*10 + (str[i]-ASCII_NUM_OFFSET);
+    }
+    return true;
 }
 
-static void set_PWM(const uint8_t pwm){
-    PWM = (pwm > MAX_PWM)?MAX_PWM:pwm;
+/**
+ * @brief Parses unsigned hex number (upper case digits)
+ * @param str Digits (not null-terminated)
+ * @param len Number of digits, max 4
+ * @param value Parsed value
+ * @return false if @str contains anything but hex digits
+ */
+static bool parse_hex(const char *str, uint8_t len, uint16_t *value){
+    *value = 0;
+    for(uint8_t i = 0; i < len; i++){
+        uint8_t nibble;
+        if(str[i] >= '0' && str[i] <= '9'){
+            nibble = str[i] - '0';
+        } else if(str[i] >= 'A' && str[i] <= 'F'){
+            nibble = str[i] - 'A' + 10;
+        } else {
+            return false;
+        }
+        *value = (*value << 4) | nibble;
+    }
+    return true;
+}
+
+/**
+ * @brief Applies new battery correction to current PWM
+ * @param msg Correction in percent as decimal digits (not null-terminated)
+ * @param msg_len Number of digits
+ */
+static void set_battery_correction(const char *msg, uint8_t msg_len){
+    uint16_t correction;
+    if(!parse_decimal(msg, msg_len, &correction)){
+        return;
+    }
+    if(correction < BATTERY_CORRECTION_MIN || correction > BATTERY_CORRECTION_MAX){
+        return;
+    }
+    battery_correction = correction;
+    update_targets();
+}
+
+/**
+ * @brief Sets common duty from ICCM message
+ * @param msg Duty as 2 hex digits, e.g. 80
+ * @param msg_len Length of @msg
+ */
+static void set_duty_from_msg(const char *msg, uint8_t msg_len){
+    uint16_t duty;
+    if(msg_len == DUTY_ARG_LENGTH && parse_hex(msg, DUTY_ARG_LENGTH, &duty)){
+        set_duty(duty);
+    }
+}
+
+/**
+ * @brief Sets duty of every motor from ICCM message
+ * @param msg Signed duty of motors M1..M4, sign and 2 hex digits each, e.g. +80-80+80-80
+ * @param msg_len Length of @msg
+ */
+static void set_motors_duty_from_msg(const char *msg, uint8_t msg_len){
+    int16_t duty[MOTOR_NUM];
+    if(msg_len != MOTOR_NUM*MOTOR_DUTY_ARG_LENGTH){
+        return;
+    }
+    for(uint8_t i = 0; i < MOTOR_NUM; i++, msg += MOTOR_DUTY_ARG_LENGTH){
+        uint16_t value;
+        if((msg[0] != '+' && msg[0] != '-') || !parse_hex(msg+1, DUTY_ARG_LENGTH, &value)){
+            return;
+        }
+        duty[i] = (msg[0] == '-') ? -(int16_t)value : (int16_t)value;
+    }
+    for(uint8_t i = 0; i < MOTOR_NUM; i++){
+        set_motor_duty((Motor_ID_T)i, duty[i]);
+    }
+}
+
+/**
+ * @brief Loads wheel trims from EEPROM, trims stay at unity if EEPROM doesn't contain valid record
+ */
+static void load_trims(void){
+    Trim_Record_T record;
+    eeprom_read_block(&record, &stored_trims, sizeof(record));
+    if(record.magic != TRIM_MAGIC){
+        return;
+    }
+    for(uint8_t i = 0; i < MOTOR_NUM; i++){
+        if(record.trim[i] < TRIM_MIN || record.trim[i] > TRIM_UNITY){
+            return;
+        }
+    }
+    memcpy(trims, record.trim, sizeof(trims));
+}
+
+/**
+ * @brief Sets trim of every wheel and stores them in EEPROM (only changed bytes are written)
+ * @param new_trims Trims of M1..M4, values are limited to TRIM_MIN - TRIM_UNITY
+ */
+static void set_trims(const uint16_t *new_trims){
+    Trim_Record_T record;
+    for(uint8_t i = 0; i < MOTOR_NUM; i++){
+        trims[i] = (new_trims[i] < TRIM_MIN) ? TRIM_MIN : (new_trims[i] > TRIM_UNITY) ? TRIM_UNITY : new_trims[i];
+    }
+    record.magic = TRIM_MAGIC;
+    memcpy(record.trim, trims, sizeof(trims));
+    eeprom_update_block(&record, &stored_trims, sizeof(record));
+    update_targets();
+}
+
+/**
+ * @brief Sets wheel trims from ICCM message
+ * @param msg Trims of M1..M4, 3 hex digits each (100 hex = TRIM_UNITY), e.g. 1001000F00F0
+ * @param msg_len Length of @msg
+ */
+static void set_trims_from_msg(const char *msg, uint8_t msg_len){
+    uint16_t new_trims[MOTOR_NUM];
+    if(msg_len != MOTOR_NUM*TRIM_ARG_LENGTH){
+        return;
+    }
+    for(uint8_t i = 0; i < MOTOR_NUM; i++){
+        if(!parse_hex(msg + i*TRIM_ARG_LENGTH, TRIM_ARG_LENGTH, &new_trims[i])){
+            return;
+        }
+    }
+    set_trims(new_trims);
+}
+
+/**
+ * @brief Cancels queued and currently executed motion primitives, motors keep the current movement
+ */
+static void clear_motion_queue(void){
+    motion_queue_count = 0;
+    motion_active = false;
+}
+
+/**
+ * @brief Appends motion primitive to the queue
+ * @return false if queue is full
+ */
+static bool enqueue_motion(char movement, uint8_t duty, uint16_t duration_ms){
+    if(motion_queue_count >= MOTION_QUEUE_SIZE){
+        return false;
+    }
+    Motion_Primitive_T *primitive = &motion_queue[(motion_queue_head + motion_queue_count) % MOTION_QUEUE_SIZE];
+    primitive->movement = movement;
+    primitive->duty = duty;
+    primitive->duration_ms = duration_ms;
+    motion_queue_count++;
+    return true;
+}
+
+/**
+ * @brief Appends motion primitives from ICCM message to the queue, message is rejected as a whole if any primitive is invalid
+ * @param msg Motion primitives: movement cmd, duty (2 hex digits), duration in ms (3 hex digits), e.g. B99064R99120
+ * @param msg_len Length of @msg
+ */
+static void enqueue_motions_from_msg(const char *msg, uint8_t msg_len){
+    if(msg_len == 0 || msg_len % MOTION_ARG_LENGTH != 0){
+        return;
+    }
+    for(uint8_t i = 0; i < msg_len; i += MOTION_ARG_LENGTH){
+        uint16_t value;
+        const char movement = msg[i];
+        if((movement != MOTORS_GO_FORWARD && movement != MOTORS_GO_BACKWARD && movement != MOTORS_TURN_RIGHT && 
+            movement != MOTORS_TURN_LEFT && movement != MOTORS_STOP) ||
+           !parse_hex(msg+i+1, DUTY_ARG_LENGTH, &value) || 
+           !parse_hex(msg+i+1+DUTY_ARG_LENGTH, DURATION_ARG_LENGTH, &value)){
+            return;
+        }
+    }
+    for(uint8_t i = 0; i < msg_len; i += MOTION_ARG_LENGTH){
+        uint16_t duty, duration_ms;
+        parse_hex(msg+i+1, DUTY_ARG_LENGTH, &duty);
+        parse_hex(msg+i+1+DUTY_ARG_LENGTH, DURATION_ARG_LENGTH, &duration_ms);
+        enqueue_motion(msg[i], duty, duration_ms);
+    }
+}
+
+/**
+ * @brief Replaces motion queue with right turn requested via serial (drvtr)
+ */
+static void run_turn_request(void){
+    uint16_t duration_ms;
+    if(!turn_requested){
+        return;
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        duration_ms = turn_request_ms;
+        turn_requested = false;
+    }
+    clear_motion_queue();
+    enqueue_motion(MOTORS_TURN_RIGHT, requested_duty, duration_ms);
+}
+
+/**
+ * @brief Latches debug cmd received via serial, it is applied by run_debug_cmd. Serial callbacks run in ISR,
+ * drive state (motors, slot images, motion queue) is changed in main loop only. Newer cmd replaces a pending one.
+ * @param handler function applying the cmd
+ * @param data received cmd
+ * @param data_len size of @data
+ */
+static void defer_debug_cmd(Debug_Cmd_Handler_T handler, const void *data, size_t data_len){
+    if(data_len > sizeof(debug_cmd)){
+        return;
+    }
+    memcpy(debug_cmd, data, data_len);
+    debug_cmd_len = data_len;
+    debug_cmd_handler = handler;
+}
+
+/**
+ * @brief Applies debug cmd latched by defer_debug_cmd
+ */
+static void run_debug_cmd(void){
+    Debug_Cmd_Handler_T handler;
+    char cmd[DEBUG_CMD_BUFFER_SIZE];
+    uint8_t cmd_len;
+    if(debug_cmd_handler == NULL){
+        return;
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        handler = debug_cmd_handler;
+        cmd_len = debug_cmd_len;
+        memcpy(cmd, debug_cmd, cmd_len);
+        debug_cmd_handler = NULL;
+    }
+    handler(cmd, cmd_len);
+}
+
+/**
+ * @brief Starts the next motion primitive once the current one expires. Next primitive is timed from the planned end of the previous one,
+ * so delays of the main loop don't accumulate. Motors are stopped when the queue runs empty.
+ */
+static void run_motion_queue(void){
+    if(reverse_thrust_active){
+        return;
+    }
+    if(motion_active && sys_tick_elapsed_ms(motion_start_ms) < motion_duration_ms){
+        return;
+    }
+    if(motion_queue_count == 0){
+        if(motion_active){
+            motion_active = false;
+            stop();
+        }
+        return;
+    }
+    const Motion_Primitive_T *primitive = &motion_queue[motion_queue_head];
+    motion_queue_head = (motion_queue_head + 1) % MOTION_QUEUE_SIZE;
+    motion_queue_count--;
+    motion_start_ms = motion_active ? motion_start_ms + motion_duration_ms : sys_tick_get_ms();
+    motion_duration_ms = primitive->duration_ms;
+    motion_active = true;
+    set_duty(primitive->duty);
+    set_movement(primitive->movement);
+}
+
+/**
+ * @brief Moves duty towards target by at most DRIVE_ACCEL_STEP (speeding up) or DRIVE_DECEL_STEP (slowing down) per PWM period
+ * Change of direction always slows down to 0 first.
+ */
+static int16_t limit_slew(int16_t duty, int16_t target, uint8_t periods){
+    const int16_t accel = (int16_t)periods * DRIVE_ACCEL_STEP;
+    const int16_t decel = (int16_t)periods * DRIVE_DECEL_STEP;
+    if(duty > 0 && target < duty){
+        const int16_t limit = (target > 0) ? target : 0;
+        return (duty - limit > decel) ? duty - decel : limit;
+    }
+    if(duty < 0 && target > duty){
+        const int16_t limit = (target < 0) ? target : 0;
+        return (limit - duty > decel) ? duty + decel : limit;
+    }
+    if(target > duty){
+        return (target - duty > accel) ? duty + accel : target;
+    }
+    if(target < duty){
+        return (duty - target > accel) ? duty - accel : target;
+    }
+    return duty;
+}
+
+/**
+ * @brief Returns kick-start length for requested duty (nominal, without battery correction and trim, so the level doesn't shift
+ * as the battery sags)
+ * @return Number of PWM periods, 0 if motor should start with slew rate limit
+ */
+static uint8_t get_kick_periods(int16_t requested){
+    const uint8_t level = PWM_TO_LEVEL(abs(requested));
+    const uint8_t idx = (level < KICK_START_MIN_LEVEL) ? 0 : level - KICK_START_MIN_LEVEL;
+    const uint16_t periods = MS_TO_PWM_PERIODS(kick_start_ms[idx]);
+    return (periods > UINT8_MAX) ? UINT8_MAX : periods;
+}
+
+/**
+ * @brief Computes output duty of motor after @elapsed PWM periods: kick-start when starting from rest, slew rate limit otherwise
+ */
+static int16_t next_duty(Motor_T *motor, uint8_t elapsed){
+    const int16_t target = motor->target_duty;
+    if(motor->kick_periods > 0){
+        /* Kick is cancelled when the motor should stop or reverse */
+        if((motor->duty > 0 && target > 0) || (motor->duty < 0 && target < 0)){
+            motor->kick_periods = (motor->kick_periods > elapsed) ? motor->kick_periods - elapsed : 0;
+            return (motor->kick_periods > 0) ? motor->duty : target;
+        }
+        motor->kick_periods = 0;
+    }
+    const int16_t new_duty = limit_slew(motor->duty, target, elapsed);
+    if(motor->duty == 0 && new_duty != 0){
+        motor->kick_periods = get_kick_periods(motor->requested_duty);
+        if(motor->kick_periods > 0){
+            return (target > 0) ? MAX_DUTY : -MAX_DUTY;
+        }
+    }
+    return new_duty;
+}
+
+/**
+ * @brief Sets direction of motor when its duty changes sign, pins are updated with the next BCM images
+ */
+static void apply_direction(Motor_T *motor, int16_t new_duty){
+    if(new_duty > 0 && motor->duty <= 0){
+        motor->direction = DIRECTION_CW;
+    } else if(new_duty < 0 && motor->duty >= 0){
+        motor->direction = DIRECTION_CCW;
+    } else if(new_duty == 0 && motor->duty != 0){
+        motor->direction = DIRECTION_COAST;
+    }
+}
+
+/**
+ * @brief Steps duty of every motor towards its target for PWM periods elapsed since the last call, updates BCM images if needed
+ */
+static void update_slew(void){
+    static uint8_t last_periods = 0;
+    const uint8_t periods = PWM_periods;
+    const uint8_t elapsed = periods - last_periods;
+    bool changed = false;
+
+    if(elapsed == 0){
+        return;
+    }
+    last_periods = periods;
+    for(uint8_t i = 0; i < MOTOR_NUM; i++){
+        Motor_T *motor = &motors[i];
+        const int16_t new_duty = next_duty(motor, elapsed);
+        if(new_duty != motor->duty){
+            apply_direction(motor, new_duty);
+            motor->duty = new_duty;
+            changed = true;
+        }
+    }
+    if(changed){
+        update_PWM_slots();
+    }
+}
+
+/**
+ * @brief Stops all motors immediately with shorted windings (IN1=IN2=high), duty drops to 0 without slew rate limit
+ */
+static void short_brake(void){
+    reverse_thrust_active = false;
+    for(uint8_t i = 0; i < MOTOR_NUM; i++){
+        motors[i].requested_duty = 0;
+        motors[i].target_duty = 0;
+        motors[i].duty = 0;
+        motors[i].kick_periods = 0;
+        motors[i].direction = DIRECTION_BRAKE;
+    }
+    update_PWM_slots();
+}
+
+/**
+ * @brief Drives every moving motor against its motion with full duty, pulse length is DRIVE_REVERSE_THRUST_MS scaled by duty
+ * of the fastest motor. Motors are short braked when the pulse ends (run_reverse_thrust()).
+ */
+static void start_reverse_thrust(void){
+    uint8_t fastest = 0;
+    for(uint8_t i = 0; i < MOTOR_NUM; i++){
+        const uint8_t duty = abs(motors[i].duty);
+        fastest = (duty > fastest) ? duty : fastest;
+    }
+    if(fastest == 0){
+        short_brake();
+        return;
+    }
+    for(uint8_t i = 0; i < MOTOR_NUM; i++){
+        Motor_T *motor = &motors[i];
+        const int16_t new_duty = (motor->duty > 0) ? -MAX_DUTY : (motor->duty < 0) ? MAX_DUTY : 0;
+        if(new_duty == 0){
+            motor->direction = DIRECTION_BRAKE;
+        } else {
+            apply_direction(motor, new_duty);
+        }
+        motor->requested_duty = new_duty;
+        motor->target_duty = new_duty;
+        motor->duty = new_duty;
+        motor->kick_periods = 0;
+    }
+    update_PWM_slots();
+    reverse_thrust_active = true;
+    reverse_thrust_start_ms = sys_tick_get_ms();
+    reverse_thrust_duration_ms = (uint32_t)DRIVE_REVERSE_THRUST_MS * fastest / MAX_DUTY;
+}
+
+/**
+ * @brief Ends reverse thrust pulse once it expires
+ */
+static void run_reverse_thrust(void){
+    if(reverse_thrust_active && sys_tick_elapsed_ms(reverse_thrust_start_ms) >= reverse_thrust_duration_ms){
+        short_brake();
+    }
+}
+
+/**
+ * @brief Stops the robot with given brake mode
+ * @param mode MOTORS_BRAKE_SHORT, MOTORS_BRAKE_REVERSE, anything else - coast
+ */
+static void brake(char mode){
+    switch (mode){
+    case MOTORS_BRAKE_SHORT:
+        short_brake();
+        break;
+    case MOTORS_BRAKE_REVERSE:
+        start_reverse_thrust();
+        break;
+    default:
+        stop();
+        /* Release motors left in short brake, the others coast once slowed down to 0 */
+        for(uint8_t i = 0; i < MOTOR_NUM; i++){
+            if(motors[i].duty == 0){
+                motors[i].direction = DIRECTION_COAST;
+            }
+        }
+        update_PWM_slots();
+        break;
+    }
 }
 
 /* Public control of PWM */
 void drive_ctrl_disable_PWM(void){
-    DISABLE_M1_PWM();
-    DISABLE_M2_PWM();
-    DISABLE_M3_PWM();
-    DISABLE_M4_PWM();
+    PWM_enabled = false;
+    update_PWM_slots();
 }
 
 void drive_ctrl_enable_PWM(void){
-    ENABLE_M1_PWM();
-    ENABLE_M2_PWM();
-    ENABLE_M3_PWM();
-    ENABLE_M4_PWM();
+    PWM_enabled = true;
+    update_PWM_slots();
 }
 
 /**
- * @brief Used in ISR to provide smooth PWM switching (without visible motor turn-on/off)
+ * @brief Used in Timer0 overflow ISR - starts the next BCM slot, switches to staged images at the start of PWM period
+ * Timer is reloaded relative to its current value, so ISR latency doesn't stretch the slot. Only motor pins are written, 
+ * other pins of the ports are modified by main loop with single-instruction sbi/cbi, so they can't be corrupted.
+ * IN pins of M4 are on different ports, between the PORTB and PORTD writes (<1us) M4 may briefly be in coast or brake state, never
+ * driven in wrong direction.
  */
 void drive_ctrl_PWM_processing(void){
-    static uint8_t cnt = 0;
-    if(cnt < PWM){
-        drive_ctrl_enable_PWM();
-    } else {
-        drive_ctrl_disable_PWM();
+    if(current_slot == 0 && next_state_pending){
+        active_state ^= 1;
+        next_state_pending = false;
     }
-    if(cnt >= MAX_INT_CNT){
-        cnt = 0;
-    } else {
-        ++cnt;
+    const PWM_Slot_T *slot = &PWM_states[active_state][current_slot];
+    TCNT0 += SLOT_PRELOAD[current_slot];
+    PORTB = (PORTB & ~MOTOR_MASK_B) | slot->port_b;
+    PORTC = (PORTC & ~MOTOR_MASK_C) | slot->port_c;
+    PORTD = (PORTD & ~MOTOR_MASK_D) | slot->port_d;
+    if(++current_slot >= PWM_BITS){
+        current_slot = 0;
+        PWM_periods++;
     }
-    TCNT0 = TCNT0_INITIAL;
 }
 
 /* High-level functions*/
 void drive_ctrl_init(void){
     timer0_init(); 
+    load_trims();
 
     /*motor 1*/
     DDRC |= SB(M1_IN1);
@@ -189,26 +876,23 @@ void drive_ctrl_init(void){
 }
 
 void drive_ctrl_run(void){
-    static char rx_buff[10];
+    static char rx_buff[DRIVE_CTRL_RX_BUFFER_SIZE];
     static uint8_t data_length = 0;
     if(ICCM_is_data_available()){
         ICCM_read_rx_buffer(rx_buff, &data_length);
+        rx_buff[data_length] = '\0';
         switch (rx_buff[0])
         {
         case MOTORS_GO_FORWARD:
-            go_forward();
-            break;
         case MOTORS_GO_BACKWARD:
-            go_backward();
-            break;
         case MOTORS_TURN_RIGHT:
-            turn_right();
-            break;
         case MOTORS_TURN_LEFT:
-            turn_left();
+            clear_motion_queue();
+            set_movement(rx_buff[0]);
             break;
         case MOTORS_STOP:
-            stop();
+            clear_motion_queue();
+            brake(rx_buff[1]);
             break;
         case MOTORS_PWM_20:
             set_PWM(20);
@@ -237,31 +921,178 @@ void drive_ctrl_run(void){
         case MOTORS_PWM_100:
             set_PWM(100);
             break;
+        case MOTORS_BATTERY_CORRECTION:
+            set_battery_correction(rx_buff+1, data_length-1);
+            break;
+        case MOTORS_SET_DUTY:
+            set_duty_from_msg(rx_buff+1, data_length-1);
+            break;
+        case MOTORS_SET_MOTORS:
+            set_motors_duty_from_msg(rx_buff+1, data_length-1);
+            break;
+        case MOTORS_QUEUE:
+            clear_motion_queue();
+            enqueue_motions_from_msg(rx_buff+1, data_length-1);
+            break;
+        case MOTORS_QUEUE_APPEND:
+            enqueue_motions_from_msg(rx_buff+1, data_length-1);
+            break;
+        case MOTORS_SET_TRIMS:
+            set_trims_from_msg(rx_buff+1, data_length-1);
+            break;
         default:
             break;
         }
     } 
+    run_debug_cmd();
+    run_turn_request();
+    run_reverse_thrust();
+    run_motion_queue();
+    update_slew();
 }
 
 /* Debug callbacks */
+/**
+ * @brief Applies drvpwm cmd in main loop
+ */
+static void apply_pwm_cmd(const char *cmd, uint8_t cmd_len){
+    uint16_t arg_value;
+    if(cmd_len > DRVPWM_CMD_ARGUMENT_OFFSET && 
+       parse_decimal(cmd+DRVPWM_CMD_ARGUMENT_OFFSET, cmd_len-DRVPWM_CMD_ARGUMENT_OFFSET, &arg_value)){
+        set_PWM(arg_value > MAX_PWM ? MAX_PWM : arg_value);
+    }
+}
+
 /**
  * @brief Debug function for serial module to allow PWM setting via UART
  * @param data cmd with parameter: drvpwm xxx, where xxx is PWM value in range of 0-100
  * @param data_len size of @data
  */
 void drive_ctrl_set_pwm_cbk(const void *data, size_t data_len){
-    uint8_t arg_value = atoi(((const char*)data)+DRVPWM_CMD_ARGUMENT_OFFSET);
-    set_PWM(arg_value);
+    defer_debug_cmd(apply_pwm_cmd, data, data_len);
 }
 
 /**
- * @brief Debug function for motor control
- * @param data data in format: drvctrl f/b/l/r/s, example: drvctrl f
+ * @brief Applies drvdty cmd in main loop
+ */
+static void apply_duty_cmd(const char *cmd, uint8_t cmd_len){
+    uint16_t arg_value;
+    if(cmd_len > DRVDTY_CMD_ARGUMENT_OFFSET && 
+       parse_decimal(cmd+DRVDTY_CMD_ARGUMENT_OFFSET, cmd_len-DRVDTY_CMD_ARGUMENT_OFFSET, &arg_value)){
+        set_duty(arg_value > MAX_DUTY ? MAX_DUTY : arg_value);
+    }
+}
+
+/**
+ * @brief Debug function for serial module to allow full resolution duty setting via UART
+ * @param data cmd with parameter: drvdty xxx, where xxx is duty in range of 0-255
  * @param data_len size of @data
  */
-void drive_ctrl_set_movement_cbk(const void *data, size_t data_len){
-    char subcmd = ((const char*)data)[8];
-    switch (subcmd){
+void drive_ctrl_set_duty_cbk(const void *data, size_t data_len){
+    defer_debug_cmd(apply_duty_cmd, data, data_len);
+}
+
+/**
+ * @brief Applies drvm cmd in main loop
+ */
+static void apply_motor_cmd(const char *cmd, uint8_t cmd_len){
+    uint8_t pwm_offset = DRVM_PWM_ARGUMENT_OFFSET;
+    uint16_t pwm;
+    if(cmd_len <= DRVM_PWM_ARGUMENT_OFFSET){
+        return;
+    }
+    const bool is_negative = (cmd[pwm_offset] == '-');
+    if(is_negative || cmd[pwm_offset] == '+'){
+        pwm_offset++;
+    }
+    uint8_t motor = cmd[DRVM_MOTOR_ARGUMENT_OFFSET] - '1';
+    if(motor < MOTOR_NUM && cmd_len > pwm_offset && parse_decimal(cmd+pwm_offset, cmd_len-pwm_offset, &pwm)){
+        const int16_t duty = PWM_TO_DUTY((pwm > MAX_PWM) ? MAX_PWM : pwm);
+        set_motor_duty((Motor_ID_T)motor, is_negative ? -duty : duty);
+    }
+}
+
+/**
+ * @brief Debug function to set PWM of single motor
+ * @param data cmd with parameters: drvm n xxx, where n is motor 1-4 and xxx is signed PWM in range of -100-100, example: drvm 2 -50.
+ *             Cmd with invalid PWM is ignored.
+ * @param data_len size of @data
+ */
+void drive_ctrl_set_motor_cbk(const void *data, size_t data_len){
+    defer_debug_cmd(apply_motor_cmd, data, data_len);
+}
+
+/**
+ * @brief Prints battery correction, requested PWM and output duty (0-255, signed) of every motor via serial (debug)
+ */
+void drive_ctrl_print_PWM(void){
+    log_data_2("Batt corr=%u%% duty=%u", battery_correction, requested_duty);
+    log_data_4("M=%d/%d/%d/%d", motors[M1_ID].duty, motors[M2_ID].duty, motors[M3_ID].duty, motors[M4_ID].duty);
+}
+
+/**
+ * @brief Applies drvks cmd in main loop
+ */
+static void apply_kick_start_cmd(const char *cmd, uint8_t cmd_len){
+    uint16_t value;
+    if(cmd_len > DRVKS_TIME_ARGUMENT_OFFSET && 
+       parse_decimal(cmd+DRVKS_TIME_ARGUMENT_OFFSET, cmd_len-DRVKS_TIME_ARGUMENT_OFFSET, &value)){
+        const char level = cmd[DRVKS_LEVEL_ARGUMENT_OFFSET];
+        const uint8_t idx = (level == MOTORS_PWM_100) ? KICK_START_LEVELS-1 : level - '0' - KICK_START_MIN_LEVEL;
+        if(idx < KICK_START_LEVELS){
+            kick_start_ms[idx] = (value > UINT8_MAX) ? UINT8_MAX : value;
+        }
+    }
+    log_data_5("Kick=%u/%u/%u/%u/%u", kick_start_ms[0], kick_start_ms[1], kick_start_ms[2], kick_start_ms[3], kick_start_ms[4]);
+    log_data_4("Kick70+=%u/%u/%u/%u", kick_start_ms[5], kick_start_ms[6], kick_start_ms[7], kick_start_ms[8]);
+}
+
+/**
+ * @brief Debug function to print or tune kick-start table
+ * @param data "drvks" prints kick-start length of all PWM levels, "drvks n xxx" sets length of level n (2-9 for 20-90%, X for 100%) 
+ *             to xxx ms (0-255), example: drvks 3 40
+ * @param data_len size of @data
+ */
+void drive_ctrl_kick_start_cbk(const void *data, size_t data_len){
+    defer_debug_cmd(apply_kick_start_cmd, data, data_len);
+}
+
+/**
+ * @brief Applies drvtm cmd in main loop, EEPROM write takes several ms and would block all interrupts in ISR
+ */
+static void apply_trim_cmd(const char *cmd, uint8_t cmd_len){
+    uint16_t value;
+    if(cmd_len > DRVTM_TRIM_ARGUMENT_OFFSET && 
+       parse_decimal(cmd+DRVTM_TRIM_ARGUMENT_OFFSET, cmd_len-DRVTM_TRIM_ARGUMENT_OFFSET, &value)){
+        uint8_t motor = cmd[DRVTM_MOTOR_ARGUMENT_OFFSET] - '1';
+        if(motor < MOTOR_NUM){
+            uint16_t new_trims[MOTOR_NUM];
+            memcpy(new_trims, trims, sizeof(trims));
+            new_trims[motor] = value;
+            set_trims(new_trims);
+        }
+    }
+    log_data_4("Trim=%u/%u/%u/%u", trims[M1_ID], trims[M2_ID], trims[M3_ID], trims[M4_ID]);
+}
+
+/**
+ * @brief Debug function to print or set wheel trims
+ * @param data "drvtm" prints trims of all wheels, "drvtm n xxx" sets trim of wheel n (1-4), xxx in range 128-256 (256 = 1.0)
+ * @param data_len size of @data
+ */
+void drive_ctrl_trim_cbk(const void *data, size_t data_len){
+    defer_debug_cmd(apply_trim_cmd, data, data_len);
+}
+
+/**
+ * @brief Applies drvctrl cmd in main loop
+ */
+static void apply_movement_cmd(const char *cmd, uint8_t cmd_len){
+    if(cmd_len <= DRVCTRL_ARGUMENT_OFFSET){
+        return;
+    }
+    switch (cmd[DRVCTRL_ARGUMENT_OFFSET]){
+
     case 'f':
         go_forward();
         break;
@@ -275,32 +1106,39 @@ void drive_ctrl_set_movement_cbk(const void *data, size_t data_len){
         turn_right();
         break;
     case 's':
-        stop();
+        brake(MOTORS_BRAKE_COAST);
+        break;
+    case 'h':
+        brake(MOTORS_BRAKE_SHORT);
+        break;
+    case 'x':
+        brake(MOTORS_BRAKE_REVERSE);
         break;
     default:
         break;
     }
 }
 
+/**
+ * @brief Debug function for motor control
+ * @param data data in format: drvctrl f/b/l/r/s/h/x (s - coast, h - short brake, x - reverse thrust), example: drvctrl f
+ * @param data_len size of @data
+ */
+void drive_ctrl_set_movement_cbk(const void *data, size_t data_len){
+    defer_debug_cmd(apply_movement_cmd, data, data_len);
+}
+
+/**
+ * @brief Debug function - turns right for given time using motion queue
+ * @param data cmd with parameter: drvtr xxx, where xxx is time in ms (0-999), example: drvtr 250
+ * @param data_len size of @data
+ */
 void drive_ctrl_turn_right_cbk(const void *data, size_t data_len){
-    const uint8_t *data_ptr = (const uint8_t*)data;
-    uint16_t arg_value = (data_ptr[DRVTR_ARGUMENT_OFFSET]-ASCII_NUM_OFFSET)*100;
-    arg_value += (data_ptr[DRVTR_ARGUMENT_OFFSET+1]-ASCII_NUM_OFFSET)*10;
-    arg_value += (data_ptr[DRVTR_ARGUMENT_OFFSET+2]-ASCII_NUM_OFFSET);
-    turn_right();
-    switch (arg_value){
-    case 100:
-        _delay_ms(100);
-        break;
-    case 500:
-        _delay_ms(500);
-        break;
-    case 999:
-        _delay_ms(999);
-        break;
-    default:
-        _delay_ms(100);
-        break;
+    uint16_t duration_ms;
+    if(data_len > DRVTR_ARGUMENT_OFFSET && 
+       parse_decimal(((const char*)data)+DRVTR_ARGUMENT_OFFSET, data_len-DRVTR_ARGUMENT_OFFSET, &duration_ms)){
+        /* Serial callbacks run in ISR, motion queue is changed in main loop */
+        turn_request_ms = duration_ms;
+        turn_requested = true;
     }
-    stop();
 }
\ No newline at end of file
@@ -0,0 +1,190 @@
+/*! @file ds_calibration.c
+    @brief Distance sensor noise floor calibration
+    Ambient IR differs between venues and shifts DS readings taken with no target in view. Calibration measures mean and standard deviation
+    of every DS (nothing may be in front of the robot) and places per-sensor thresholds above that noise floor:
+    - trigger: mean + DS_TRIGGER_SIGMA standard deviations, at least DS_MIN_MARGIN_ADC counts,
+    - lock:    mean + DS_LOCK_SIGMA standard deviations, at least 2*DS_MIN_MARGIN_ADC counts.
+    Thresholds are converted to millimetres and limit the ranges of active strategy profile - a sensor never reports a target 
+    further away than its noise floor allows. Results are stored in EEPROM and loaded at startup.
+    Calibration is started via serial command (executed from main loop, while AI is IDLE) or during ARMED countdown (DS_CALIBRATION_ON_ARM).
+*/
+
+#include <stdbool.h>
+#include <avr/eeprom.h>
+#include "config.h"
+#include "serial_tx.h"
+#include "sys_tick.h"
+#include "sensor_hub.h"
+#include "AI.h"
+#include "ds_calibration.h"
+
+#define LOG_MODULE LOG_MODULE_DS_CALIBRATION
+
+#define DS_CALIBRATION_MAGIC (0xC0 | DS_NUM)  /* Layout changes with number of sensors */
+#define DS_CALIBRATION_SAMPLES 256
+#define DS_SAMPLE_PERIOD_MS 4               /* Samples spread over ~1s */
+#define DS_TRIGGER_SIGMA 4
+#define DS_LOCK_SIGMA 8
+#define DS_MIN_MARGIN_ADC 20
+#define ADC_MAX_VALUE 1023
+#define NO_LIMIT_MM 0xFFFF
+#define DSCAL_CMD_ARGUMENT_OFFSET 6
+
+/**
+ * @brief Calibration record, stored in EEPROM
+ */
+typedef struct DS_Calibration_Tag{
+    uint8_t magic;
+    uint16_t noise_mean[DS_NUM];
+    uint16_t noise_sd[DS_NUM];
+    uint16_t trigger_adc[DS_NUM];
+    uint16_t lock_adc[DS_NUM];
+} DS_Calibration_T;
+
+static DS_Calibration_T EEMEM stored_calibration;
+static DS_Calibration_T calibration;
+static uint16_t trigger_mm[DS_NUM];
+static uint16_t lock_mm[DS_NUM];
+static volatile bool calibration_requested = false;
+
+/**********************************************************************
+* Static functions 
+***********************************************************************/
+/**
+ * @brief Integer square root (bit-by-bit)
+ */
+static uint16_t isqrt(uint32_t value){
+    uint32_t result = 0;
+    uint32_t bit = 1UL << 30;
+    while(bit > value){
+        bit >>= 2;
+    }
+    while(bit != 0){
+        if(value >= result + bit){
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t)result;
+}
+
+static uint16_t limit_adc(uint32_t adc_val){
+    return (adc_val > ADC_MAX_VALUE) ? ADC_MAX_VALUE : (uint16_t)adc_val;
+}
+
+/**
+ * @brief Converts ADC thresholds to millimetres, without valid calibration thresholds don't limit the strategy profile
+ */
+static void update_thresholds_mm(void){
+    bool valid = (calibration.magic == DS_CALIBRATION_MAGIC);
+    for(uint8_t i = 0; i < DS_NUM; i++){
+        trigger_mm[i] = valid ? distance_sensor_adc_to_mm(calibration.trigger_adc[i]) : NO_LIMIT_MM;
+        lock_mm[i] = valid ? distance_sensor_adc_to_mm(calibration.lock_adc[i]) : NO_LIMIT_MM;
+    }
+}
+
+/**********************************************************************
+* Public functions 
+***********************************************************************/
+/**
+ * @brief Loads calibration from EEPROM
+ */
+void ds_calibration_init(void){
+    eeprom_read_block(&calibration, &stored_calibration, sizeof(calibration));
+    update_thresholds_mm();
+}
+
+/**
+ * @brief Measures noise floor of all DS, derives thresholds and stores them in EEPROM. Blocks for ~1s.
+ */
+void ds_calibration_measure(void){
+    uint32_t sum[DS_NUM] = {0};
+    uint32_t sum_sq[DS_NUM] = {0};
+    Sensor_Snapshot_T sensors;
+    uint16_t last_sample_ms = sys_tick_get_ms();
+
+    log_info_P(PROGMEM_DS_CALIBRATION_STARTED);
+    for(uint16_t n = 0; n < DS_CALIBRATION_SAMPLES; n++){
+        while(sys_tick_elapsed_ms(last_sample_ms) < DS_SAMPLE_PERIOD_MS){
+        }
+        last_sample_ms += DS_SAMPLE_PERIOD_MS;
+        sensor_hub_get_snapshot(&sensors);
+        for(uint8_t i = 0; i < DS_NUM; i++){
+            sum[i] += sensors.ds_filtered[i];
+            sum_sq[i] += (uint32_t)sensors.ds_filtered[i] * sensors.ds_filtered[i];
+        }
+    }
+
+    for(uint8_t i = 0; i < DS_NUM; i++){
+        const uint16_t mean = sum[i] / DS_CALIBRATION_SAMPLES;
+        const uint32_t mean_sq = sum_sq[i] / DS_CALIBRATION_SAMPLES;
+        const uint32_t variance = (mean_sq > (uint32_t)mean*mean) ? mean_sq - (uint32_t)mean*mean : 0;
+        const uint16_t sd = isqrt(variance);
+        const uint16_t trigger_margin = (DS_TRIGGER_SIGMA*sd > DS_MIN_MARGIN_ADC) ? DS_TRIGGER_SIGMA*sd : DS_MIN_MARGIN_ADC;
+        const uint16_t lock_margin = (DS_LOCK_SIGMA*sd > 2*DS_MIN_MARGIN_ADC) ? DS_LOCK_SIGMA*sd : 2*DS_MIN_MARGIN_ADC;
+        calibration.noise_mean[i] = mean;
+        calibration.noise_sd[i] = sd;
+        calibration.trigger_adc[i] = limit_adc((uint32_t)mean + trigger_margin);
+        calibration.lock_adc[i] = limit_adc((uint32_t)mean + lock_margin);
+    }
+    calibration.magic = DS_CALIBRATION_MAGIC;
+    eeprom_update_block(&calibration, &stored_calibration, sizeof(calibration));
+    update_thresholds_mm();
+    ds_calibration_print();
+}
+
+/**
+ * @brief Executes calibration requested via serial, called from main loop. Ignored unless AI is IDLE.
+ */
+void ds_calibration_run(void){
+    if(calibration_requested){
+        calibration_requested = false;
+        if(AI_get_status() == AI_IDLE){
+            ds_calibration_measure();
+        }
+    }
+}
+
+/**
+ * @brief Returns max distance at which DS may report a target (NO_LIMIT_MM if not calibrated)
+ */
+uint16_t ds_calibration_get_trigger_mm(DS_ID_T DS_ID){
+    return trigger_mm[DS_ID];
+}
+
+/**
+ * @brief Returns max distance at which DS may confirm a locked target (NO_LIMIT_MM if not calibrated)
+ */
+uint16_t ds_calibration_get_lock_mm(DS_ID_T DS_ID){
+    return lock_mm[DS_ID];
+}
+
+/**
+ * @brief Prints noise floor and thresholds of all DS via serial
+ */
+void ds_calibration_print(void){
+    if(calibration.magic != DS_CALIBRATION_MAGIC){
+        log_info_P(PROGMEM_DS_NOT_CALIBRATED);
+        return;
+    }
+    for(uint8_t i = 0; i < DS_NUM; i++){
+        log_data_3("DS%u noise=%u sd=%u", i+1, calibration.noise_mean[i], calibration.noise_sd[i]);
+        log_data_3("DS%u trg=%umm lck=%umm", i+1, trigger_mm[i], lock_mm[i]);
+    }
+}
+
+/* Debug callbacks */
+/**
+ * @brief Serial command: "dscal s" starts calibration (nothing may be in front of the robot), "dscal" prints stored results
+ */
+void ds_calibration_cbk(const void *data, size_t data_len){
+    if(data_len > DSCAL_CMD_ARGUMENT_OFFSET && ((const char*)data)[DSCAL_CMD_ARGUMENT_OFFSET] == 's'){
+        /* Serial callbacks run in ISR, measurement is done in main loop */
+        calibration_requested = true;
+    } else {
+        ds_calibration_print();
+    }
+}
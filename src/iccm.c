@@ -6,10 +6,13 @@
 #include "config.h"
 #include <util/delay.h>
 #include <avr/io.h>
+#include <util/atomic.h>
 #include "serial_tx.h"
 #include "string.h"
 #include "ICCM_message_catalog.h"
 
+#define LOG_MODULE LOG_MODULE_ICCM
+
 /* Disable debug logs if AI_DEBUG is not defined during build */
 #ifndef ICCM_DEBUG
     #undef log_info_P
@@ -83,19 +86,22 @@ static ICCM_DataFrame_T create_frame(char c){
 /**
  * @brief Transmits frame bits into a sequence of high and low voltage states on ICCM_TX pin
  * Data is send starting from far right bit. ICCM_DELAY_US must be the same on both MCUs.
+ * Frame is sent with interrupts disabled - any ISR executed in the middle of the frame would stretch the bit and corrupt the data.
  * @param frame Data to be send to another MCU
  */
 static void transmit(ICCM_DataFrame_T frame){
-    for(uint8_t i = 0; i < ICCM_FRAME_SIZE; i++){
-        uint8_t current_bit = (frame.raw_bits>>i) & 0x0001;
-        if(current_bit){
-            PORTD |= SB(ICCM_TX);
-        } else {
-            PORTD &= CB(ICCM_TX);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        for(uint8_t i = 0; i < ICCM_FRAME_SIZE; i++){
+            uint8_t current_bit = (frame.raw_bits>>i) & 0x0001;
+            if(current_bit){
+                PORTD |= SB(ICCM_TX);
+            } else {
+                PORTD &= CB(ICCM_TX);
+            }
+            _delay_us(ICCM_DELAY_US);
         }
-        _delay_us(ICCM_DELAY_US);
+        PORTD &= CB(ICCM_TX);
     }
-    PORTD &= CB(ICCM_TX);
 }
 
 /**
@@ -1,11 +1,15 @@
 /*! @file line_sensor.c
-    @brief Handles line detection with 4 IR reflection sensors
+    @brief Handles line detection with IR reflection sensors listed in LS_TOPOLOGY (config.h)
+    Sensors are sampled from the system tick ISR (every 1 ms), all of them with a single PIND read. Sample has to differ from the current 
+    state DEBOUNCE_COUNTER_MAX times in a row before the state changes. Every line detection (rising edge of debounced state) is latched 
+    together with its timestamp and stays latched until consumer acknowledges it, so even line flicker shorter than AI loop is not lost.
 */
 
+#include <util/atomic.h>
 #include "config.h"
 #include "serial_tx.h"
 #include "line_sensor.h"
-#include "serial_tx.h"
+#include "sys_tick.h"
 
 /* Local macro-like functions */
 #define SB(x) (1<<(x))          
@@ -17,15 +21,17 @@ typedef struct Line_Sensor_Tag{
     uint8_t pin;
     bool status;
     uint8_t debounce_counter; 
+    uint16_t edge_ms;
 } Line_Sensor_T;
 
-static Line_Sensor_T line_sensor_array[] = {
-    {LS1, false, 0},
-    {LS2, false, 0},
-    {LS3, false, 0},
-    {LS4, false, 0}
+#define LS_RECORD(name, pin, angle) {pin, false, 0, 0},
+static Line_Sensor_T line_sensor_array[LS_NUM] = {
+    LS_TOPOLOGY(LS_RECORD)
 };
 
+static uint8_t current_mask = 0;
+static uint8_t latched_mask = 0;
+
 /**
  * @brief Helper function to set bit regardless of the bit value
  */
@@ -40,22 +46,57 @@ static void force_bit(uint8_t *result, bool bit_status, uint8_t index)
 }
 
 /**
- * @brief Reads all line sensors pins and provides simple debouncing
+ * @brief Sets sensor pins as inputs
+ */
+void line_sensor_init(void){
+    for(uint8_t i=0; i<NUM_ELEMS(line_sensor_array); i++){
+        DDRD &= CB(line_sensor_array[i].pin);
+    }
+}
+
+/**
+ * @brief Used in system tick ISR - reads all line sensor pins at once, debounces them and latches line detections
  */
-static void update_sensor_status(){
+void line_sensor_sample(void){
+    const uint8_t pins = PIND;
+    const uint16_t now_ms = sys_tick_get_ms();
     for(uint8_t i=0; i<NUM_ELEMS(line_sensor_array); i++){
-        bool new_status = !(PIND & SB(line_sensor_array[i].pin));
-        line_sensor_array[i].status = new_status;
+        Line_Sensor_T *sensor = &line_sensor_array[i];
+        bool new_status = !(pins & SB(sensor->pin));
+        if(new_status == sensor->status){
+            sensor->debounce_counter = 0;
+        } else if(++sensor->debounce_counter >= DEBOUNCE_COUNTER_MAX){
+            sensor->debounce_counter = 0;
+            sensor->status = new_status;
+            force_bit(&current_mask, new_status, i);
+            if(new_status && !(latched_mask & SB(i))){
+                sensor->edge_ms = now_ms;
+                latched_mask |= SB(i);
+            }
+        }
     }
 }
 
 /**
- * @brief Returns byte where bits 0-3 describe status of respective line sensor: 1(line detected) or 0(line NOT detected)
+ * @brief Returns current and latched masks of line sensors (see Line_Sensor_Status_T)
  */
-uint8_t line_sensor_get_status(){
-    update_sensor_status();
-    uint8_t result = 0;
-    for(uint8_t i=0; i<NUM_ELEMS(line_sensor_array); i++)
-        force_bit(&result, line_sensor_array[i].status, i);
+Line_Sensor_Status_T line_sensor_get_status(void){
+    Line_Sensor_Status_T result;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        result.current = current_mask;
+        result.latched = latched_mask;
+        for(uint8_t i=0; i<NUM_ELEMS(line_sensor_array); i++){
+            result.edge_ms[i] = line_sensor_array[i].edge_ms;
+        }
+    }
     return result;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Clears latched detections of sensors in @mask, sensors still over the line stay set in current mask
+ */
+void line_sensor_acknowledge(uint8_t mask){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        latched_mask &= ~mask;
+    }
+}
@@ -0,0 +1,201 @@
+/*! @file maneuver.c
+    @brief Non-blocking playback of timed motor command sequences
+    Maneuver is a PROGMEM table of steps (command, PWM, duration). Each step is sent to MCU2 via ICCM when it starts, maneuver_run() has to be 
+    called periodically to advance to the next step once the current one has expired.
+*/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <avr/pgmspace.h>
+#include "config.h"
+#include "ICCM.h"
+#include "ICCM_message_catalog.h"
+#include "sys_tick.h"
+#include "maneuver.h"
+
+#define MAX_DUTY 255
+#define PWM_TO_DUTY(pwm) ((uint16_t)(pwm) * MAX_DUTY / MANEUVER_MAX_PWM)
+#define DUTY_MSG_SIZE 4         /* "D" + 2 hex digits + null */
+#define MOTORS_MSG_SIZE 14      /* "M" + 4x signed 2-hex-digit duty + null */
+#define QUEUE_MSG_SIZE (1 + MANEUVER_QUEUE_MAX_STEPS*6 + 1)    /* "Q" + steps (cmd, 2 hex duty, 3 hex duration) + null */
+#define TRIMS_MSG_SIZE (1 + MANEUVER_MOTOR_NUM*3 + 1)           /* "T" + 4x 3-hex-digit trim + null */
+
+static const Maneuver_Step_T *current_steps = NULL;
+static uint8_t step_idx = 0;
+static uint16_t step_start_ms = 0;
+static bool loop_enabled = false;
+static bool running = false;
+static uint8_t current_PWM = 0;
+
+/**
+ * @brief Writes @value as @digits upper case hex digits (format of ICCM arguments, see ICCM_message_catalog.h), no terminator
+ * @return Position behind the last digit
+ */
+static char* put_hex(char *dst, uint16_t value, uint8_t digits){
+    for(uint8_t i = digits; i > 0; i--){
+        const uint8_t nibble = value & 0x0F;
+        dst[i-1] = (nibble < 10) ? '0' + nibble : 'A' + (nibble - 10);
+        value >>= 4;
+    }
+    return dst + digits;
+}
+
+/**********************************************************************
+* Static functions 
+***********************************************************************/
+static void load_step(Maneuver_Step_T *step){
+    memcpy_P(step, &current_steps[step_idx], sizeof(Maneuver_Step_T));
+}
+
+/**
+ * @brief Sends commands of the current step. Wraps around (or finishes the maneuver) when end of table is reached.
+ */
+static void execute_step(void){
+    Maneuver_Step_T step;
+    load_step(&step);
+    if(step.cmd == NULL){
+        if(loop_enabled && step_idx > 0){
+            step_idx = 0;
+            load_step(&step);
+        } else {
+            running = false;
+            return;
+        }
+    }
+    maneuver_set_PWM(step.PWM);
+    ICCM_send(step.cmd);
+    step_start_ms = sys_tick_get_ms();
+}
+
+/**********************************************************************
+* Public functions 
+***********************************************************************/
+/**
+ * @brief Starts maneuver, first step is executed immediately
+ * @param steps PROGMEM table of steps
+ * @param loop  true if maneuver should start over after the last step
+ */
+void maneuver_start(const Maneuver_Step_T *steps, bool loop){
+    current_steps = steps;
+    loop_enabled = loop;
+    step_idx = 0;
+    running = true;
+    execute_step();
+}
+
+/**
+ * @brief Advances the maneuver if current step has expired
+ * @return true if maneuver is still in progress
+ */
+bool maneuver_run(void){
+    if(running){
+        Maneuver_Step_T step;
+        load_step(&step);
+        if(step.duration_ms != MANEUVER_HOLD && sys_tick_elapsed_ms(step_start_ms) >= step.duration_ms){
+            step_idx++;
+            execute_step();
+        }
+    }
+    return running;
+}
+
+void maneuver_stop(void){
+    running = false;
+}
+
+/**
+ * @brief Checks if maneuver described by @steps is currently being played
+ */
+bool maneuver_is_running(const Maneuver_Step_T *steps){
+    return running && (current_steps == steps);
+}
+
+/**
+ * @brief Sends PWM value to MCU2 as full resolution duty, value is limited to MANEUVER_MIN_PWM - MANEUVER_MAX_PWM
+ */
+void maneuver_set_PWM(uint8_t PWM){
+    if(PWM < MANEUVER_MIN_PWM){
+        PWM = MANEUVER_MIN_PWM;
+    } else if(PWM > MANEUVER_MAX_PWM){
+        PWM = MANEUVER_MAX_PWM;
+    }
+    current_PWM = PWM;
+    maneuver_set_duty(PWM_TO_DUTY(PWM));
+}
+
+/**
+ * @brief Sends common duty (0-255) of all motors to MCU2
+ */
+void maneuver_set_duty(uint8_t duty){
+    char msg[DUTY_MSG_SIZE] = MOTORS_SET_DUTY;
+    *put_hex(msg + sizeof(MOTORS_SET_DUTY)-1, duty, 2) = '\0';
+    ICCM_send(msg);
+}
+
+uint8_t maneuver_get_PWM(void){
+    return current_PWM;
+}
+
+/**
+ * @brief Sends separate PWM of every motor to MCU2 (arcs, pivots), overrides the last movement command until the next one
+ * @param PWM Signed PWM of motors M1..M4 in range -100 - 100, positive - CW, negative - CCW
+ */
+void maneuver_set_motors_PWM(const int8_t *PWM){
+    char msg[MOTORS_MSG_SIZE] = MOTORS_SET_MOTORS;
+    char *msg_ptr = msg + sizeof(MOTORS_SET_MOTORS)-1;
+    for(uint8_t i = 0; i < MANEUVER_MOTOR_NUM; i++){
+        int8_t value = PWM[i];
+        if(value > MANEUVER_MAX_PWM){
+            value = MANEUVER_MAX_PWM;
+        } else if(value < -MANEUVER_MAX_PWM){
+            value = -MANEUVER_MAX_PWM;
+        }
+        *msg_ptr++ = (value < 0) ? '-' : '+';
+        msg_ptr = put_hex(msg_ptr, PWM_TO_DUTY(abs(value)), 2);
+    }
+    *msg_ptr = '\0';
+    ICCM_send(msg);
+}
+
+/**
+ * @brief Sends steps to MCU2 motion queue in a single ICCM message. MCU2 times the steps itself (no delays between them) and stops 
+ * the motors after the last one. Unlike maneuver_start(), steps are kept in RAM and nothing has to be called afterwards.
+ * @param steps Steps to be executed, PWM is limited as in maneuver_set_PWM(), duration to MANEUVER_QUEUE_MAX_MS
+ * @param count Number of steps, at most MANEUVER_QUEUE_MAX_STEPS
+ */
+void maneuver_send_queue(const Maneuver_Step_T *steps, uint8_t count){
+    char msg[QUEUE_MSG_SIZE] = MOTORS_QUEUE;
+    char *msg_ptr = msg + sizeof(MOTORS_QUEUE)-1;
+    if(count > MANEUVER_QUEUE_MAX_STEPS){
+        count = MANEUVER_QUEUE_MAX_STEPS;
+    }
+    for(uint8_t i = 0; i < count; i++){
+        uint8_t PWM = steps[i].PWM;
+        if(PWM < MANEUVER_MIN_PWM){
+            PWM = MANEUVER_MIN_PWM;
+        } else if(PWM > MANEUVER_MAX_PWM){
+            PWM = MANEUVER_MAX_PWM;
+        }
+        const uint16_t duration_ms = (steps[i].duration_ms > MANEUVER_QUEUE_MAX_MS) ? MANEUVER_QUEUE_MAX_MS : steps[i].duration_ms;
+        *msg_ptr++ = steps[i].cmd[0];
+        msg_ptr = put_hex(msg_ptr, PWM_TO_DUTY(PWM), 2);
+        msg_ptr = put_hex(msg_ptr, duration_ms, 3);
+        current_PWM = PWM;
+    }
+    *msg_ptr = '\0';
+    ICCM_send(msg);
+}
+
+/**
+ * @brief Sends wheel trims to MCU2, MCU2 stores them in EEPROM
+ * @param trims Trims of motors M1..M4, MANEUVER_TRIM_UNITY = 1.0
+ */
+void maneuver_set_trims(const uint16_t *trims){
+    char msg[TRIMS_MSG_SIZE] = MOTORS_SET_TRIMS;
+    char *msg_ptr = msg + sizeof(MOTORS_SET_TRIMS)-1;
+    for(uint8_t i = 0; i < MANEUVER_MOTOR_NUM; i++){
+        msg_ptr = put_hex(msg_ptr, (trims[i] > MANEUVER_TRIM_UNITY) ? MANEUVER_TRIM_UNITY : trims[i], 3);
+    }
+    *msg_ptr = '\0';
+    ICCM_send(msg);
+}
\ No newline at end of file
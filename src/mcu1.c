@@ -12,6 +12,13 @@
 #include "distance_sensor.h"
 #include "ADC.h"
 #include "AI.h"
+#include "sys_tick.h"
+#include "battery.h"
+#include "ds_calibration.h"
+#include "trim_calibration.h"
+#include "brake_test.h"
+
+#define LOG_MODULE LOG_MODULE_MCU1
 
 /**
  * @brief Main function
@@ -23,12 +30,19 @@ int main(){
     ICCM_init();
     ADC_init();
     distance_sensor_init();
+    ds_calibration_init();
+    line_sensor_init();
+    sys_tick_init();
     sei();
     log_info_P(PROGMEM_MCU1_ONLINE);
     /* MCU1 start processing */
     print_AI_status();
     while(1){ 
         AI_run();
+        battery_run();
+        ds_calibration_run();
+        trim_calibration_run();
+        brake_test_run();
     }
     return 0;
 }
\ No newline at end of file
@@ -10,6 +10,9 @@
 #include "ISR.h"
 #include "ICCM.h"
 #include "drive_ctrl.h"
+#include "sys_tick.h"
+
+#define LOG_MODULE LOG_MODULE_MCU2
 
 
 /**
@@ -20,6 +23,7 @@ int main(){
     serial_init(F_CPU, BAUD);
     ICCM_init();
     drive_ctrl_init();
+    sys_tick_init();
     sei();
     log_info_P(PROGMEM_MCU2_ONLINE);
 
@@ -0,0 +1,101 @@
+/*! @file opening_book.c
+    @brief Library of opening moves
+    Openings are timed maneuver scripts kept in PROGMEM. Script is selected before the match (serial cmd or button-press count, see AI.c) 
+    and played by AI right after the countdown. Every script ends with a step held until AI takes over on the first sensor input.
+    Step durations are tuned for PWM 100, where 90 deg rotation takes ~100 ms (see ROTATION_ADJUSTMENT_TABLE in AI.c).
+*/
+
+#include <avr/pgmspace.h>
+#include "config.h"
+#include "serial_tx.h"
+#include "ICCM_message_catalog.h"
+#include "opening_book.h"
+
+#define LOG_MODULE LOG_MODULE_OPENING_BOOK
+
+/* Disable debug logs if AI_DEBUG is not defined during build */
+#ifndef AI_DEBUG
+    #undef log_info_P
+    #define log_info_P(str)
+    #undef log_info
+    #define log_info(str)
+    #undef log_warn
+    #define log_warn(str)
+    #undef log_warn_P
+    #define log_warn_P(str)
+    #undef log_err
+    #define log_err(str)
+    #undef log_err_P
+    #define log_err_P(str)
+    #undef log_raw_string
+    #define log_raw_string(str)
+#endif
+
+#define OPENING_MAX_STEPS 5
+#define OPEN_CMD_ARGUMENT_OFFSET 5
+
+typedef struct Opening_Tag{
+    uint8_t name_id;                            /* Progmem_Table_Index_T of opening name */
+    Maneuver_Step_T script[OPENING_MAX_STEPS];
+} Opening_T;
+
+static const Opening_T OPENINGS[OPENING_NUM] PROGMEM = {
+    [OPENING_CHARGE] = {
+        PROGMEM_OPENING_CHARGE,
+        {{MOTORS_GO_FORWARD, 100, MANEUVER_HOLD}, {NULL, 0, 0}}
+    },
+    [OPENING_SIDE_STEP_LEFT] = {
+        PROGMEM_OPENING_SIDE_STEP_LEFT,
+        {{MOTORS_TURN_LEFT, 100, 50}, {MOTORS_GO_FORWARD, 100, 250}, {MOTORS_TURN_RIGHT, 100, 100}, {MOTORS_GO_FORWARD, 100, MANEUVER_HOLD}, {NULL, 0, 0}}
+    },
+    [OPENING_SIDE_STEP_RIGHT] = {
+        PROGMEM_OPENING_SIDE_STEP_RIGHT,
+        {{MOTORS_TURN_RIGHT, 100, 50}, {MOTORS_GO_FORWARD, 100, 250}, {MOTORS_TURN_LEFT, 100, 100}, {MOTORS_GO_FORWARD, 100, MANEUVER_HOLD}, {NULL, 0, 0}}
+    },
+    [OPENING_SPIN_AND_CHARGE] = {
+        PROGMEM_OPENING_SPIN_AND_CHARGE,
+        {{MOTORS_TURN_RIGHT, 100, 200}, {MOTORS_GO_FORWARD, 100, MANEUVER_HOLD}, {NULL, 0, 0}}
+    }
+};
+
+static Opening_ID_T selected_id = OPENING_CHARGE;
+
+/**
+ * @brief Selects opening to be played at the start of next match
+ */
+void opening_book_select(Opening_ID_T id){
+    if(id < OPENING_NUM){
+        selected_id = id;
+    }
+    opening_book_print();
+}
+
+Opening_ID_T opening_book_get_id(void){
+    return selected_id;
+}
+
+/**
+ * @brief Returns PROGMEM table of steps of selected opening
+ */
+const Maneuver_Step_T* opening_book_get_script(void){
+    return OPENINGS[selected_id].script;
+}
+
+void opening_book_print(void){
+    log_info_P(pgm_read_byte(&OPENINGS[selected_id].name_id));
+}
+
+/* Debug callbacks */
+/**
+ * @brief Debug function to select the opening via UART
+ * @param data cmd with parameter: open x, where x is opening number (0-3)
+ * @param data_len size of @data
+ */
+void opening_book_set_cbk(const void *data, size_t data_len){
+    const char arg = (data_len > OPEN_CMD_ARGUMENT_OFFSET) ? ((const char*)data)[OPEN_CMD_ARGUMENT_OFFSET] : '\0';
+    if(arg >= '0' && arg < '0'+OPENING_NUM){
+        opening_book_select((Opening_ID_T)(arg-'0'));
+    } else {
+        opening_book_print();
+    }
+}
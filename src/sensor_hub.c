@@ -0,0 +1,78 @@
+/*! @file sensor_hub.c
+    @brief Coherent snapshots of all sensors
+    Hub is the ADC sink of distance sensors (see ADC_SCAN_LIST), it publishes a snapshot every time a complete set of DS samples is ready. Snapshot is written into the back buffer and the buffers 
+    are swapped afterwards, so the publisher never waits for readers. Reader copies the front buffer and checks the publish counter - 
+    the copy is valid unless the same buffer got overwritten in the meantime (two publishes during a single copy), in which case it is retried.
+*/
+
+#include <avr/io.h>
+#include "config.h"
+#include "serial_tx.h"
+#include "sys_tick.h"
+#include "sensor_hub.h"
+
+#define LOG_MODULE LOG_MODULE_SENSOR_HUB
+
+#define SNAPSHOT_BUFFERS_NUM 2
+
+static Sensor_Snapshot_T snapshots[SNAPSHOT_BUFFERS_NUM];
+static volatile uint8_t front_idx = 0;
+static volatile uint8_t publish_count = 0;
+static uint16_t seq = 0;
+
+/**
+ * @brief Publishes the latest state of all sensors
+ */
+static void publish(void){
+    uint8_t back_idx = front_idx ^ 1;
+    Sensor_Snapshot_T *snapshot = &snapshots[back_idx];
+    DS_Snapshot_T ds;
+    Line_Sensor_Status_T ls = line_sensor_get_status();
+
+    distance_sensor_get_snapshot(&ds);
+    snapshot->seq = ++seq;
+    snapshot->timestamp_ms = sys_tick_get_ms();
+    for(uint8_t i = 0; i < DS_NUM; i++){
+        snapshot->ds_filtered[i] = ds.filtered[i];
+        snapshot->ds_raw[i] = ds.raw[i];
+    }
+    snapshot->ls_current = ls.current;
+    snapshot->ls_latched = ls.latched;
+
+    front_idx = back_idx;
+    publish_count++;
+}
+
+/**
+ * @brief ADC sink of distance sensors, used in ADC ISR. Snapshot is published once sample of the last DS is stored.
+ */
+void sensor_hub_on_DS_sample(uint8_t DS_ID, uint16_t adc_val){
+    distance_sensor_read_ADC((DS_ID_T)DS_ID, adc_val);
+    if(DS_ID == DS_NUM-1){
+        publish();
+    }
+}
+
+/**
+ * @brief Copies the latest published snapshot, never blocks the publisher
+ * Compare snapshot->seq with the previously consumed value to find out whether new data has arrived.
+ */
+void sensor_hub_get_snapshot(Sensor_Snapshot_T *snapshot){
+    uint8_t count_before;
+    do {
+        count_before = publish_count;
+        *snapshot = snapshots[front_idx];
+    } while((uint8_t)(publish_count - count_before) >= SNAPSHOT_BUFFERS_NUM);
+}
+
+/**
+ * @brief Prints the latest snapshot via serial (debug)
+ */
+void sensor_hub_print(void){
+    Sensor_Snapshot_T snapshot;
+    sensor_hub_get_snapshot(&snapshot);
+    log_data_4("#%u t=%u LS=%x/%x", snapshot.seq, snapshot.timestamp_ms, snapshot.ls_current, snapshot.ls_latched);
+    for(uint8_t i = 0; i < DS_NUM; i++){
+        log_data_3("DS%u=%u raw=%u", i+1, snapshot.ds_filtered[i], snapshot.ds_raw[i]);
+    }
+}
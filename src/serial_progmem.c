@@ -4,9 +4,7 @@
 */
 #include <avr/pgmspace.h>
 
-#define DATA_CONVERSION_BUFFER_SIZE 30
-
-/* Literals kept in codeflash for logging                       0|                             |29*/
+/* Literals kept in codeflash for logging, streamed to serial directly from flash */
 static const char PROGMEM_TX_BUFFER_OVERFLOW_P[]       PROGMEM = "TX buffer overflow!";
 static const char PROGMEM_LOG_BUFFERING_ENABLED_P[]    PROGMEM = "Log buffering enabled";
 static const char PROGMEM_LOG_BUFFERING_DISABLED_P[]   PROGMEM = "Log buffering disabled";
@@ -25,11 +23,22 @@ static const char PROGMEM_AI_STATUS_ATTACK_P[]         PROGMEM = "AI status: ATT
 static const char PROGMEM_AI_STATUS_RETURN_P[]         PROGMEM = "AI status: RETURN";
 static const char PROGMEM_AI_FORCED_STOP_P[]           PROGMEM = "AI forced stop";
 static const char PROGMEM_AI_INIT_IN_P[]               PROGMEM = "AI init in:";
+static const char PROGMEM_STRATEGY_AGGRESSIVE_P[]      PROGMEM = "Strategy: AGGRESSIVE";
+static const char PROGMEM_STRATEGY_COUNTER_PUNCHER_P[] PROGMEM = "Strategy: COUNTER-PUNCHER";
+static const char PROGMEM_STRATEGY_EDGE_TRAPPER_P[]    PROGMEM = "Strategy: EDGE-TRAPPER";
+static const char PROGMEM_STRATEGY_AUTO_P[]            PROGMEM = "Strategy: auto switching";
+static const char PROGMEM_AI_STATUS_OPENING_P[]        PROGMEM = "AI status: OPENING";
+static const char PROGMEM_OPENING_CHARGE_P[]           PROGMEM = "Opening: CHARGE";
+static const char PROGMEM_OPENING_SIDE_STEP_LEFT_P[]   PROGMEM = "Opening: SIDE-STEP LEFT";
+static const char PROGMEM_OPENING_SIDE_STEP_RIGHT_P[]  PROGMEM = "Opening: SIDE-STEP RIGHT";
+static const char PROGMEM_OPENING_SPIN_AND_CHARGE_P[]  PROGMEM = "Opening: SPIN AND CHARGE";
+static const char PROGMEM_DS_CALIBRATION_STARTED_P[]   PROGMEM = "DS calibration started";
+static const char PROGMEM_DS_NOT_CALIBRATED_P[]        PROGMEM = "DS not calibrated";
+static const char PROGMEM_TRIM_CALIBRATION_STARTED_P[] PROGMEM = "Trim calibration started";
+static const char PROGMEM_TRIM_CALIBRATION_NO_WALL_P[] PROGMEM = "Trim calibration: no wall";
+static const char PROGMEM_BRAKE_TEST_NO_WALL_P[]       PROGMEM = "Brake test: no wall";
 
 
-/* Buffer used for data exchange between RAM and FLASH */
-char data_conversion_buffer[DATA_CONVERSION_BUFFER_SIZE] = {};
-
 /* Table for accessing PROGMEM strings*/
 const char* const progmem_string_table[] PROGMEM = {
     PROGMEM_TX_BUFFER_OVERFLOW_P, 
@@ -49,5 +58,19 @@ const char* const progmem_string_table[] PROGMEM = {
     PROGMEM_AI_STATUS_ATTACK_P,
     PROGMEM_AI_STATUS_RETURN_P,
     PROGMEM_AI_FORCED_STOP_P,
-    PROGMEM_AI_INIT_IN_P
+    PROGMEM_AI_INIT_IN_P,
+    PROGMEM_STRATEGY_AGGRESSIVE_P,
+    PROGMEM_STRATEGY_COUNTER_PUNCHER_P,
+    PROGMEM_STRATEGY_EDGE_TRAPPER_P,
+    PROGMEM_STRATEGY_AUTO_P,
+    PROGMEM_AI_STATUS_OPENING_P,
+    PROGMEM_OPENING_CHARGE_P,
+    PROGMEM_OPENING_SIDE_STEP_LEFT_P,
+    PROGMEM_OPENING_SIDE_STEP_RIGHT_P,
+    PROGMEM_OPENING_SPIN_AND_CHARGE_P,
+    PROGMEM_DS_CALIBRATION_STARTED_P,
+    PROGMEM_DS_NOT_CALIBRATED_P,
+    PROGMEM_TRIM_CALIBRATION_STARTED_P,
+    PROGMEM_TRIM_CALIBRATION_NO_WALL_P,
+    PROGMEM_BRAKE_TEST_NO_WALL_P
 };
\ No newline at end of file
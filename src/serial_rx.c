@@ -12,6 +12,17 @@
 #include "ICCM.h"
 #include "config.h"
 #include "drive_ctrl.h"
+#ifdef MCU1
+#include "strategy.h"
+#include "opening_book.h"
+#include "sensor_hub.h"
+#include "battery.h"
+#include "ds_calibration.h"
+#include "trim_calibration.h"
+#include "brake_test.h"
+#endif
+
+#define LOG_MODULE LOG_MODULE_SERIAL_RX
 
 /* Disable debug logs if AI_DEBUG is not defined during build */
 #ifndef SERIAL_RX_DEBUG
@@ -31,7 +42,7 @@
     #define log_raw_string(str)
 #endif
 
-#define CMD_NAME_LENGTH 7
+#define CMD_NAME_LENGTH 8           /* Max. 7 characters + terminator */
 #define RX_BUFFER_SIZE 12 /* 7 chars for cmd, 1 space, 3 chars for arg, NULL */
 
 /**
@@ -54,7 +65,6 @@ const Cmd_Record_T cmd_list[] = {
 
 /* Local static functions */
 static bool to_rx_buffer(const char c);
-static void to_udr(const unsigned char c);
 static const Cmd_Record_T* find_cmd(const char *cmd);
 
 /**
@@ -79,34 +89,24 @@ static bool to_rx_buffer(const char c){
  */
 static const Cmd_Record_T* find_cmd(const char *cmd){
     const char *first_space = strchr(cmd, SPACE_CHAR);
+    const size_t name_length = (first_space != NULL) ? (size_t)(first_space-cmd) : strlen(cmd);
     char cmd_name[CMD_NAME_LENGTH] = {};
 
-    if(first_space != NULL){
-        memcpy((void *)cmd_name, (const void*)cmd, (size_t)(first_space-cmd));
-        cmd_name[first_space-cmd] = NULL_CHAR;
-    } else {
-        strcpy(cmd_name, cmd);
-    }
+    /* Longer name can't match any cmd */
+    if(name_length < CMD_NAME_LENGTH){
+        memcpy((void *)cmd_name, (const void*)cmd, name_length);
+        cmd_name[name_length] = NULL_CHAR;
 
-    for(uint8_t i = 0; i < arr_length(cmd_list); i++){
-        if(0 == strcmp(cmd_list[i].string, cmd_name)){
-            return &(cmd_list[i]);
+        for(uint8_t i = 0; i < arr_length(cmd_list); i++){
+            if(0 == strcmp(cmd_list[i].string, cmd_name)){
+                return &(cmd_list[i]);
+            }
         }
     }
     log_err_P(PROGMEM_CMD_NOT_FOUND);
     return NULL;
 }
 
-/**
- * @brief Sends char c to UDR
- * @param c Char to be send
- */
-static void to_udr(const unsigned char c){
-    while ( !( UCSRA & (1<<UDRE)) )
-    ;
-    UDR = c;
-}
-
 /* Global functions */
 
 /**
@@ -137,13 +137,13 @@ void serial_on_receive(const char c){
 }
 
 /**
- * @brief Transfer contents of rx_buffer to UDR (this is debug command)
+ * @brief Transfer contents of rx_buffer to serial TX (this is debug command)
  */
 void serial_read_rx_buffer(void){
     if(rx_buffer_head != rx_buffer){
         char *rx_buffer_head_ptr = rx_buffer;
         while(rx_buffer_head_ptr < rx_buffer_head){
-            to_udr(*rx_buffer_head_ptr++);
+            serial_send_char(*rx_buffer_head_ptr++);
         }
     }
 }
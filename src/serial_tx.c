@@ -1,13 +1,23 @@
 /** @file serial_tx.c
 *   @brief Implementation of UART transmission 
+*   Logs are not sent directly, characters are queued in TX ring and moved to UDR by USART Data Register Empty interrupt, so logging 
+*   never waits for UART (one character takes ~1ms at 9600 baud). Any context, including ISRs, may log.
+*   Overflow policy: log which doesn't fit into free space of TX ring is dropped as a whole (a full log is never cut in the middle 
+*   by the log itself), raw strings are dropped per character. Dropped characters are counted, see txstat cmd.
+*   Space for the whole log is reserved atomically before it is written, a log from ISR which interrupts writing of another log gets
+*   its own slots behind it, so logs are never interleaved. Reserved slots are passed to UDRE ISR once all producers finish writing.
 */
 #include "serial_tx.h"
 #include "common_const.h"
 #include <avr/io.h>
+#include <util/atomic.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#define LOG_MODULE LOG_MODULE_SERIAL_TX
+
 /* Disable debug logs if AI_DEBUG is not defined during build */
 #ifndef SERIA_TX_DEBUG
     #undef log_info_P
@@ -33,8 +43,12 @@
 #define MSG_TYPE_LENGTH      8
 #define MSG_TYPES_NUM        4
 #define DECIMAL              10
+#define UINT16_MAX_DIGITS    5
 #define UINT32_MAX_DIGITS    10
-#define OMIT_SLASH 1
+#define TX_RING_SIZE         128                /* Power of 2, max 128 */
+#define TX_RING_MASK         (TX_RING_SIZE-1)
+#define LOG_RECORD_MAX_SIZE  32                 /* Binary log record incl. sync byte and log ID */
+#define LOG_RECORD_HEADER_SIZE 3
 
 /**
  * @brief Marker used to determine if logs should be passed directly to UDR 
@@ -45,31 +59,143 @@ typedef enum Data_Target_Tag{
     T_TX_BUFFER = 1
 } Data_Target_T;
 
+/**
+ * @brief Destination of log data characters, counting pass only finds length of the log
+ */
+typedef struct Log_Output_Tag{
+    uint16_t length;        /* Characters of log data output so far */
+    bool send;              /* false - counting pass */
+    bool to_ring;           /* Log goes to reserved slots of TX ring, TX buffer otherwise */
+    uint8_t ring_pos;       /* Next reserved slot (free running index) */
+    uint8_t ring_left;      /* Reserved slots not written yet */
+} Log_Output_T;
+
+/**
+ * @brief Conversion specification of log_data_N format: %[flags][width][l]conversion
+ */
+typedef struct Format_Spec_Tag{
+    uint8_t width;
+    bool zero_pad;
+    bool left_align;
+    bool is_long;
+    char conversion;
+} Format_Spec_T;
+
 
 /* Local static variables */
 static const char msg_type_str[MSG_TYPES_NUM][MSG_TYPE_LENGTH] = {"INFO", "WARNING", "ERROR", "DATA"};
+#define LOG_MODULE_NAME(id, file) static const char id##_NAME_P[] PROGMEM = file;
+LOG_MODULE_LIST(LOG_MODULE_NAME)
+#define LOG_MODULE_NAME_PTR(id, file) id##_NAME_P,
+static const char* const log_module_names[LOG_MODULE_NUM] PROGMEM = {LOG_MODULE_LIST(LOG_MODULE_NAME_PTR)};
+static const char UNKNOWN_MODULE_NAME_P[] PROGMEM = "?";
 static char tx_buffer[TX_BUFFER_SIZE] = {0};
 static char *tx_buffer_head = tx_buffer;
 static Data_Target_T data_destination = T_UDR;
+static volatile char tx_ring[TX_RING_SIZE];
+static volatile uint8_t tx_ring_head = 0;       /* Free running indexes, end of data ready to be sent - written by producers */
+static volatile uint8_t tx_ring_reserved = 0;   /* end of slots reserved by producers */
+static volatile uint8_t tx_ring_tail = 0;       /* and next slot to be sent - written by UDRE ISR */
+static volatile uint8_t tx_ring_writers = 0;    /* Producers writing into reserved slots (nested by ISRs) */
+static volatile uint16_t tx_dropped_chars = 0;
 
 /* Local static functions */
+static void send_next_char(void);
+static bool reserve_tx_ring(uint16_t count, uint8_t *pos);
+static void commit_tx_ring(void);
+static bool to_tx_ring(const unsigned char c);
+static void drop_chars(uint16_t count);
 static void to_udr(const unsigned char c);
 static void to_tx_buffer(const char c);
 static void process_char(const unsigned char c);
-static void get_filename_from_path(char *filename, const char *path);
-static void print_msg_src(const char *src);
-static void print_msg_type(Log_Type_T msg_type);
-static void print_msg_data(const char *data);
-static void print_line_number(const uint32_t line_num);
+static void put_char(Log_Output_T *out, const char c);
+static void print_msg_src(Log_Output_T *out, uint8_t module);
+static void print_msg_type(Log_Output_T *out, Log_Type_T msg_type);
+static char get_data_char(const char *data, bool is_progmem);
+static void emit_char(Log_Output_T *out, const char c);
+static void print_msg_data(Log_Output_T *out, const char *data, bool is_progmem);
+static void format_data(Log_Output_T *out, PGM_P format, va_list args);
+static void print_line_number(Log_Output_T *out, const uint16_t line_num);
 static void show_tx_buffer_overflow_error(void);
 /**
- * @brief Moves character 'c' into UDR (USART Data Register), which equals to sending via UART/USART
- * @param c character to be stored
+ * @brief Moves the oldest character of TX ring into UDR (USART Data Register), disables UDRE interrupt when the ring is empty
+ * Must be called with interrupts disabled.
+ */
+static void send_next_char(void){
+    if(tx_ring_head == tx_ring_tail){
+        UCSRB &= ~(1<<UDRIE);
+        return;
+    }
+    UDR = tx_ring[tx_ring_tail & TX_RING_MASK];
+    tx_ring_tail++;
+}
+
+/**
+ * @brief Reserves @count slots of TX ring for one producer, then they are written without locking and passed to UDRE ISR 
+ * by commit_tx_ring(). Every successful reservation has to be committed.
+ * @param pos First reserved slot (free running index)
+ * @return false if there is not enough free space, nothing is reserved then
+ */
+static bool reserve_tx_ring(uint16_t count, uint8_t *pos){
+    bool reserved = false;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        if(count <= TX_RING_SIZE - (uint8_t)(tx_ring_reserved - tx_ring_tail)){
+            *pos = tx_ring_reserved;
+            tx_ring_reserved += count;
+            tx_ring_writers++;
+            reserved = true;
+        }
+    }
+    return reserved;
+}
+
+/**
+ * @brief Passes reserved slots to UDRE ISR. ISR producers nest into the interrupted one and finish before it continues,
+ * so once the outermost producer commits, all reserved slots are written.
+ */
+static void commit_tx_ring(void){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        if(--tx_ring_writers == 0){
+            tx_ring_head = tx_ring_reserved;
+            UCSRB |= (1<<UDRIE);
+        }
+    }
+}
+
+/**
+ * @brief Queues character 'c' for transmission, never waits
+ * @param c character to be send
+ * @return false if TX ring is full
+ */
+static bool to_tx_ring(const unsigned char c){
+    uint8_t pos;
+    if(!reserve_tx_ring(1, &pos)){
+        return false;
+    }
+    tx_ring[pos & TX_RING_MASK] = c;
+    commit_tx_ring();
+    return true;
+}
+
+static void drop_chars(uint16_t count){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        tx_dropped_chars = (UINT16_MAX - tx_dropped_chars > count) ? tx_dropped_chars + count : UINT16_MAX;
+    }
+}
+
+/**
+ * @brief Queues character 'c' for transmission, waits for free space in TX ring (used to flush TX buffer). 
+ * UDR is served by polling meanwhile, so it doesn't hang when called with interrupts disabled (serial cmds run in RX ISR).
+ * @param c character to be send
  */
 static void to_udr(const unsigned char c){
-    while ( !( UCSRA & (1<<UDRE)) )
-    ;
-    UDR = c;
+    while(!to_tx_ring(c)){
+        if(UCSRA & (1<<UDRE)){
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                send_next_char();
+            }
+        }
+    }
 }
 
 /**
@@ -87,7 +213,9 @@ static void to_tx_buffer(const char c){
 static void process_char(const unsigned char c){
     switch(data_destination){
         case T_UDR:
-            to_udr(c);
+            if(!to_tx_ring(c)){
+                drop_chars(1);
+            }
             break;
         case T_TX_BUFFER:
             if(!serial_is_tx_buffer_full()){
@@ -100,40 +228,21 @@ static void process_char(const unsigned char c){
     }
 } 
 
-/**
- * @brief Parses path, looking for last '/' character, then treats the rest as filename. 
- * Function tracks filename length and keeps it at max value MSG_SRC_LENGTH
- * @param filename output buffer for filename
- * @param path     path to be parsed (from __FILE__ attribute)
- */
-static void get_filename_from_path(char *filename, const char *path){
-    const char *last_slash_ptr = path;
-    uint8_t filename_length = 0;
-    while(*path != NULL_CHAR){
-        if(*path == SLASH_CHAR){
-            last_slash_ptr = path;
-            filename_length = 0;
-        } else {
-            filename_length++;
-        }
-        path++;
-    }
-    if(filename_length > MSG_SRC_LENGTH){
-        filename_length = MSG_SRC_LENGTH;
-    }
-    memcpy(filename, last_slash_ptr+OMIT_SLASH, filename_length);
-}
-
 /**
  * @brief Prints log source
- * Prints the name of the file where log has been created. Src string is based on __FILE__ attribute.
- * @param src __FILE__ attribute of file where message originated from
+ * Prints the name of the module where log has been created, padded or cut to MSG_SRC_LENGTH characters.
+ * @param module Log_Module_T of the log site
  */
-static void print_msg_src(const char *src){
-    char filename[MSG_SRC_LENGTH] = {"        "};
-    get_filename_from_path(filename, src);
+static void print_msg_src(Log_Output_T *out, uint8_t module){
+    PGM_P name = (module < LOG_MODULE_NUM) ? (PGM_P)pgm_read_word(&log_module_names[module]) : UNKNOWN_MODULE_NAME_P;
+    char c = pgm_read_byte(name);
     for(uint8_t i = 0; i < MSG_SRC_LENGTH; i++){
-        process_char(filename[i]);
+        if(c != NULL_CHAR){
+            put_char(out, c);
+            c = pgm_read_byte(++name);
+        } else {
+            put_char(out, SPACE_CHAR);
+        }
     }
 }
 
@@ -142,24 +251,210 @@ static void print_msg_src(const char *src){
  * Prints whether given log is INFO, WARNING or an ERROR
  * @param msg_type Enum indicating the type
  */
-static void print_msg_type(Log_Type_T msg_type){
+static void print_msg_type(Log_Output_T *out, Log_Type_T msg_type){
     uint8_t i = 0;
     while( msg_type_str[(uint8_t)msg_type][i] != NULL_CHAR){
-        process_char(msg_type_str[(uint8_t)msg_type][i]);
+        put_char(out, msg_type_str[(uint8_t)msg_type][i]);
         i++;
     }
 }
 
+/**
+ * @brief Reads character of log data from RAM or flash
+ */
+static char get_data_char(const char *data, bool is_progmem){
+    return is_progmem ? (char)pgm_read_byte(data) : *data;
+}
+
+/**
+ * @brief Writes character of the log into its reserved slots of TX ring or into TX buffer.
+ * Characters beyond the reservation are dropped (data changed between counting and sending pass).
+ */
+static void put_char(Log_Output_T *out, const char c){
+    if(!out->to_ring){
+        process_char(c);
+    } else if(out->ring_left > 0){
+        tx_ring[out->ring_pos & TX_RING_MASK] = c;
+        out->ring_pos++;
+        out->ring_left--;
+    }
+}
+
+/**
+ * @brief Outputs one character of log data, max MAX_UART_DATA_LENGTH characters are output per log
+ * Counting pass (out->send false) only counts characters, it is used to find length of the log before it is sent.
+ */
+static void emit_char(Log_Output_T *out, const char c){
+    if(out->length < MAX_UART_DATA_LENGTH){
+        if(out->send){
+            put_char(out, c);
+        }
+        out->length++;
+    }
+}
+
+static void emit_padding(Log_Output_T *out, uint8_t count){
+    while(count-- > 0){
+        emit_char(out, SPACE_CHAR);
+    }
+}
+
 /**
  * @brief Print message data
  * Iterates over data until NULL-terminator is found or MAX_UART_DATA_LENGTH characters are printed.
+ * PROGMEM data is read from flash character by character, no copy is made.
  * @param data Data (string) to be send
+ * @param is_progmem true if data is PROGMEM string
  */
-static void print_msg_data(const char *data){
-    uint16_t i = 0;
-    while( (*(data+i) != NULL_CHAR) && (MAX_UART_DATA_LENGTH > i) ){
-        process_char(*(data+i));
-        i++;
+static void print_msg_data(Log_Output_T *out, const char *data, bool is_progmem){
+    char c;
+    while((c = get_data_char(data++, is_progmem)) != NULL_CHAR && out->length < MAX_UART_DATA_LENGTH){
+        emit_char(out, c);
+    }
+}
+
+/**
+ * @brief Parses flags, width and length modifier of conversion specification, format points behind '%'
+ * @return Format behind the specification
+ */
+static PGM_P parse_format_spec(PGM_P format, Format_Spec_T *spec){
+    char c;
+    *spec = (Format_Spec_T){0};
+    while((c = pgm_read_byte(format)) == '0' || c == '-'){
+        spec->zero_pad |= (c == '0');
+        spec->left_align |= (c == '-');
+        format++;
+    }
+    while(c >= '0' && c <= '9'){
+        spec->width = spec->width*DECIMAL + (c - '0');
+        c = pgm_read_byte(++format);
+    }
+    if(c == 'l'){
+        spec->is_long = true;
+        c = pgm_read_byte(++format);
+    }
+    spec->conversion = c;
+    return (c != NULL_CHAR) ? format+1 : format;
+}
+
+/**
+ * @brief Converts number to digits, least significant first. Values without 'l' modifier are converted with 16-bit division,
+ * which is several times cheaper than 32-bit one on AVR, hex digits are got by shifts.
+ * @return Number of digits
+ */
+static uint8_t get_digits(char *digits, uint32_t value, const Format_Spec_T *spec){
+    uint8_t count = 0;
+    if(spec->conversion == 'x' || spec->conversion == 'X'){
+        const char hex_a = (spec->conversion == 'X') ? 'A' : 'a';
+        do{
+            const uint8_t digit = value & 0x0F;
+            digits[count++] = (digit < DECIMAL) ? '0' + digit : hex_a + (digit - DECIMAL);
+            value >>= 4;
+        } while(value > 0);
+    } else if(spec->is_long){
+        do{
+            digits[count++] = '0' + (value % DECIMAL);
+            value /= DECIMAL;
+        } while(value > 0);
+    } else {
+        uint16_t value16 = (uint16_t)value;
+        do{
+            digits[count++] = '0' + (value16 % DECIMAL);
+            value16 /= DECIMAL;
+        } while(value16 > 0);
+    }
+    return count;
+}
+
+/**
+ * @brief Outputs number padded to width of the specification (zero padding goes behind the sign)
+ */
+static void emit_number(Log_Output_T *out, const Format_Spec_T *spec, uint32_t value, bool is_negative){
+    char digits[UINT32_MAX_DIGITS];
+    uint8_t count = get_digits(digits, value, spec);
+    const uint8_t length = count + (is_negative ? 1 : 0);
+    const uint8_t padding = (spec->width > length) ? spec->width - length : 0;
+
+    if(!spec->left_align && !spec->zero_pad){
+        emit_padding(out, padding);
+    }
+    if(is_negative){
+        emit_char(out, '-');
+    }
+    if(!spec->left_align && spec->zero_pad){
+        for(uint8_t i = 0; i < padding; i++){
+            emit_char(out, '0');
+        }
+    }
+    while(count > 0){
+        emit_char(out, digits[--count]);
+    }
+    if(spec->left_align){
+        emit_padding(out, padding);
+    }
+}
+
+/**
+ * @brief Outputs string padded with spaces to width of the specification
+ */
+static void emit_string(Log_Output_T *out, const Format_Spec_T *spec, const char *str){
+    uint8_t length = 0;
+    while(str[length] != NULL_CHAR && length < MAX_UART_DATA_LENGTH){
+        length++;
+    }
+    const uint8_t padding = (spec->width > length) ? spec->width - length : 0;
+    if(!spec->left_align){
+        emit_padding(out, padding);
+    }
+    for(uint8_t i = 0; i < length; i++){
+        emit_char(out, str[i]);
+    }
+    if(spec->left_align){
+        emit_padding(out, padding);
+    }
+}
+
+/**
+ * @brief Formats log_data_N arguments straight into the output, replaces sprintf (vfprintf of avr-libc)
+ * Supported: %d %i %u %x %X %c %s %%, 'l' modifier for 32-bit values, width, flags '0' and '-'.
+ * Unsupported conversions are output as they are, without consuming an argument.
+ * @param format PROGMEM format string
+ */
+static void format_data(Log_Output_T *out, PGM_P format, va_list args){
+    Format_Spec_T spec;
+    char c;
+    while((c = pgm_read_byte(format++)) != NULL_CHAR){
+        if(c != '%'){
+            emit_char(out, c);
+            continue;
+        }
+        format = parse_format_spec(format, &spec);
+        switch(spec.conversion){
+            case 'd':
+            case 'i':{
+                const int32_t value = spec.is_long ? (int32_t)va_arg(args, long) : va_arg(args, int);
+                emit_number(out, &spec, (value < 0) ? 0u - (uint32_t)value : (uint32_t)value, value < 0);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X':
+                emit_number(out, &spec, spec.is_long ? (uint32_t)va_arg(args, unsigned long) : va_arg(args, unsigned int), false);
+                break;
+            case 'c':{
+                const char str[2] = {(char)va_arg(args, int), NULL_CHAR};
+                emit_string(out, &spec, str);
+                break;
+            }
+            case 's':
+                emit_string(out, &spec, va_arg(args, const char*));
+                break;
+            case NULL_CHAR:
+                break;
+            default:
+                emit_char(out, spec.conversion);
+                break;
+        }
     }
 }
 
@@ -168,11 +463,11 @@ static void print_msg_data(const char *data){
  * Converts @line_num to string and sends via serial. buff size takes into account NULL-terminator, but it is not send. 
  * @param line_num line number based on __LINE__ attribute
  */
-static void print_line_number(const uint32_t line_num){
-    char buff[UINT32_MAX_DIGITS+1] = {NULL_CHAR};
-    itoa(line_num, buff, DECIMAL);
-    for(uint8_t i = 0; buff != NULL && i < UINT32_MAX_DIGITS; i++){
-        process_char(buff[i]);
+static void print_line_number(Log_Output_T *out, const uint16_t line_num){
+    char buff[UINT16_MAX_DIGITS+1] = {NULL_CHAR};
+    utoa(line_num, buff, DECIMAL);
+    for(uint8_t i = 0; buff[i] != NULL_CHAR && i < UINT16_MAX_DIGITS; i++){
+        put_char(out, buff[i]);
     }
 }
 
@@ -192,6 +487,104 @@ static void show_tx_buffer_overflow_error(void){
         serial_enable_buffering();
 }
 
+/**
+ * @brief Reserves space for the whole log in TX ring and prints metadata of the log site in front of log data, see serial_log.
+ * Log which doesn't fit into TX ring is dropped as a whole.
+ * @param out Output with data length found by counting pass (print_msg_data or format_data), prepared for sending pass
+ * @return false if the log was dropped
+ */
+static bool start_log(const Log_Site_T *site, Log_Output_T *out){
+    const Log_Type_T log_type = pgm_read_byte(&site->log_type);
+    const uint16_t line_num = pgm_read_word(&site->line_num);
+    if(out->to_ring){
+        uint16_t length = MSG_SRC_LENGTH + strlen(msg_type_str[(uint8_t)log_type]) + 3 + out->length;  /* ':' and 2 spaces */
+        uint16_t digits = line_num;
+        do{
+            length++;
+            digits /= DECIMAL;
+        } while(digits > 0);
+        if(log_type != DATA){
+            length++;
+        }
+        if(!reserve_tx_ring(length, &out->ring_pos)){
+            drop_chars(length);
+            return false;
+        }
+        out->ring_left = length;
+    }
+    out->length = 0;
+    out->send = true;
+    print_msg_src(out, pgm_read_byte(&site->module));
+    put_char(out, COLON_CHAR);
+    print_line_number(out, line_num);
+    put_char(out, SPACE_CHAR);
+    print_msg_type(out, log_type);
+    put_char(out, SPACE_CHAR);
+    return true;
+}
+
+/**
+ * @brief Ends the log started by start_log and passes it to UDRE ISR
+ */
+static void finish_log(const Log_Site_T *site, Log_Output_T *out){
+    if(pgm_read_byte(&site->log_type) != DATA){
+        put_char(out, NEWLINE_CHAR);
+    }
+    if(out->to_ring){
+        while(out->ring_left > 0){
+            put_char(out, SPACE_CHAR);
+        }
+        commit_tx_ring();
+    }
+}
+
+/**
+ * @brief Sends log with metadata of the log site, see serial_log
+ */
+static void log_msg(const Log_Site_T *site, const char *str, bool is_progmem){
+    Log_Output_T out = {0};
+    out.to_ring = (data_destination == T_UDR);
+    if(out.to_ring){
+        print_msg_data(&out, str, is_progmem);
+    }
+    if(start_log(site, &out)){
+        print_msg_data(&out, str, is_progmem);
+        finish_log(site, &out);
+    }
+}
+
+#ifdef LOG_BINARY
+/**
+ * @brief Writes sync byte and log ID at the beginning of binary log record
+ * @return Length of the header
+ */
+static uint8_t start_record(uint8_t *record, uint16_t log_id){
+    record[0] = LOG_SYNC_BYTE;
+    record[1] = (uint8_t)log_id;
+    record[2] = (uint8_t)(log_id >> 8);
+    return LOG_RECORD_HEADER_SIZE;
+}
+
+/**
+ * @brief Sends binary log record, record which doesn't fit into TX ring is dropped as a whole
+ */
+static void send_record(const uint8_t *record, uint8_t length){
+    uint8_t pos;
+    if(data_destination != T_UDR){
+        for(uint8_t i = 0; i < length; i++){
+            process_char(record[i]);
+        }
+    } else if(reserve_tx_ring(length, &pos)){
+        for(uint8_t i = 0; i < length; i++){
+            tx_ring[(uint8_t)(pos + i) & TX_RING_MASK] = record[i];
+        }
+        commit_tx_ring();
+    } else {
+        drop_chars(length);
+    }
+}
+#endif
+
 /* Global functions */
 
 /**
@@ -225,22 +618,42 @@ void serial_init(uint32_t f_cpu, uint32_t baudrate){
  * main.c  :  44      NOTIFY    Hello from ATmega8
  * <source> <line>  <log type>  <Log data (string)>
  * Function calls subfunctions to print parts of the log + adds formatting characters
+ * @param site      PROGMEM descriptor of the log site (LOG_SITE) - module, line and type of the log
  * @param str       String to be send. Must be null-terminated
- * @param msg_type  Label describing what kind of log str is. Can be NOTIFY, WARNING, ERROR or DATA
- * @param file      String describing source of message, typically a file
- * @param line      Line in source file identifing the log
  */
-void serial_log(const Log_Metadata_T metadata, const char *str){
-    print_msg_src(metadata.filename);
-    process_char(COLON_CHAR);
-    print_line_number(metadata.line_num);
-    process_char(SPACE_CHAR);
-    print_msg_type(metadata.log_type);
-    process_char(SPACE_CHAR);
-    print_msg_data(str);
-    if(metadata.log_type != DATA){
-        process_char(NEWLINE_CHAR);
+void serial_log(const Log_Site_T *site, const char *str){
+    log_msg(site, str, false);
+}
+
+/**
+ * @brief Send PROGMEM string str via serial, the same as serial_log but str is read directly from flash
+ * @param str PROGMEM string to be send. Must be null-terminated
+ */
+void serial_log_P(const Log_Site_T *site, PGM_P str){
+    log_msg(site, str, true);
+}
+
+/**
+ * @brief Send log_data_N log via serial, arguments are formatted straight into TX ring (or TX buffer), see format_data
+ * @param site      PROGMEM descriptor of the log site (LOG_SITE)
+ * @param format    PROGMEM printf-like format
+ */
+void serial_log_data(const Log_Site_T *site, PGM_P format, ...){
+    Log_Output_T out = {0};
+    va_list args;
+    va_start(args, format);
+    out.to_ring = (data_destination == T_UDR);
+    if(out.to_ring){
+        va_list count_args;
+        va_copy(count_args, args);
+        format_data(&out, format, count_args);
+        va_end(count_args);
     }
+    if(start_log(site, &out)){
+        format_data(&out, format, args);
+        finish_log(site, &out);
+    }
+    va_end(args);
 }
 
 /**
@@ -297,5 +710,133 @@ bool serial_is_tx_buffer_full(void){
  * @brief Print only the string provided in @str (no metadata)
  */
 void serial_log_raw_string(const char *str){
-    print_msg_data(str);
+    Log_Output_T out = {0, true};
+    print_msg_data(&out, str, false);
+}
+
+/**
+ * @brief Queues single character for transmission (no metadata), character is dropped if TX ring is full
+ */
+void serial_send_char(const char c){
+    if(!to_tx_ring(c)){
+        drop_chars(1);
+    }
+}
+
+#ifdef LOG_BINARY
+/**
+ * @brief Sends binary log record of log site without arguments
+ * @param log_id ID of log site (LOG_ID)
+ */
+void serial_log_binary(uint16_t log_id){
+    uint8_t record[LOG_RECORD_HEADER_SIZE];
+    send_record(record, start_record(record, log_id));
+}
+
+/**
+ * @brief Sends binary log record of PROGMEM string log
+ * @param log_id ID of log site (LOG_ID)
+ * @param progmem_id Index of PROGMEM string (may be chosen at runtime)
+ */
+void serial_log_binary_P(uint16_t log_id, uint8_t progmem_id){
+    uint8_t record[LOG_RECORD_HEADER_SIZE+1];
+    uint8_t length = start_record(record, log_id);
+    record[length++] = progmem_id;
+    send_record(record, length);
+}
+
+/**
+ * @brief Sends binary log record with raw arguments of log_data_N, no formatting is done on the MCU
+ * Format string is only walked to find sizes of arguments: 'l' modifier - 4 bytes, 's' - null-terminated string, others - 2 bytes
+ * (int promotion). Record longer than LOG_RECORD_MAX_SIZE is dropped as a whole (counted as dropped chars), truncated 
+ * arguments would shift all following fields for the decoder.
+ * @param log_id ID of log site (LOG_ID)
+ * @param format printf-like format of the log site, PROGMEM string
+ */
+void serial_log_binary_data(uint16_t log_id, PGM_P format, ...){
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+    uint16_t length = start_record(record, log_id);
+    char c;
+    va_list args;
+    va_start(args, format);
+    while((c = pgm_read_byte(format++)) != NULL_CHAR){
+        if(c != '%'){
+            continue;
+        }
+        do{
+            c = pgm_read_byte(format++);
+        } while((c >= '0' && c <= '9') || c == '-' || c == '+' || c == ' ' || c == '#');
+        const bool is_long = (c == 'l');
+        if(is_long){
+            c = pgm_read_byte(format++);
+        }
+        if(c == NULL_CHAR){
+            break;
+        }
+        if(c == 's'){
+            const char *str = va_arg(args, const char*);
+            const size_t size = strlen(str) + 1;
+            if(length + size <= LOG_RECORD_MAX_SIZE){
+                memcpy(record+length, str, size);
+            }
+            length += size;
+        } else if(c != '%'){
+            uint32_t value = is_long ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
+            const uint8_t size = is_long ? 4 : 2;
+            if(length + size <= LOG_RECORD_MAX_SIZE){
+                for(uint8_t i = 0; i < size; i++){
+                    record[length+i] = (uint8_t)value;
+                    value >>= 8;
+                }
+            }
+            length += size;
+        }
+    }
+    va_end(args);
+    if(length > LOG_RECORD_MAX_SIZE){
+        drop_chars(length);
+        return;
+    }
+    send_record(record, length);
+}
+#endif
+
+/**
+ * @brief Used in USART Data Register Empty ISR - sends the next character of TX ring
+ */
+void serial_on_UDR_empty(void){
+    send_next_char();
+}
+
+/**
+ * @brief Prints number of characters dropped due to full TX ring since startup
+ */
+void serial_print_tx_stats(void){
+    uint16_t dropped;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        dropped = tx_dropped_chars;
+    }
+    log_data_1("TX dropped=%u", dropped);
+}
+
+/**
+ * @brief Measures CPU cycles taken by a typical log_data_N call (u16, i16, hex and u32 field) incl. queueing into TX ring
+ * TIMER1 (not used otherwise) counts CPU cycles without prescaler, interrupts are disabled during measurement.
+ * Log which doesn't fit into TX ring is dropped, so the command should be sent when the ring is empty.
+ * Serial command "logbn".
+ */
+void serial_benchmark_log(void){
+    uint16_t cycles;
+    uint16_t overhead;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        TCCR1A = 0;
+        TCNT1 = 0;
+        TCCR1B = (1<<CS10);
+        overhead = TCNT1;
+        TCNT1 = 0;
+        log_data_4("Bench %u %d %04X %lu", 1023u, -250, 0xBEEFu, 123456UL);
+        cycles = TCNT1;
+        TCCR1B = 0;
+    }
+    log_data_1("Log cycles=%u", cycles - overhead);
 }
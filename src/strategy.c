@@ -0,0 +1,241 @@
+/*! @file strategy.c
+    @brief Opponent classification and strategy profiles
+    During the match AI feeds this module with every decision it makes. Module keeps short-horizon statistics of opponent behavior 
+    (closing speed, lock evasions, stationary time) and at the end of every STATS_WINDOW_MS picks the profile which fits the opponent best.
+    Profiles are kept in flash, only thresholds of the active profile are copied to RAM. Switching happens live, without reset.
+    Statistics are decayed (halved) after every window, so old observations fade away.
+*/
+
+#include <avr/pgmspace.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "common_const.h"
+#include "serial_tx.h"
+#include "ICCM_message_catalog.h"
+#include "sys_tick.h"
+#include "strategy.h"
+
+#define LOG_MODULE LOG_MODULE_STRATEGY
+
+/* Disable debug logs if AI_DEBUG is not defined during build */
+#ifndef AI_DEBUG
+    #undef log_info_P
+    #define log_info_P(str)
+    #undef log_info
+    #define log_info(str)
+    #undef log_warn
+    #define log_warn(str)
+    #undef log_warn_P
+    #define log_warn_P(str)
+    #undef log_err
+    #define log_err(str)
+    #undef log_err_P
+    #define log_err_P(str)
+    #undef log_raw_string
+    #define log_raw_string(str)
+#endif
+
+#define MANEUVER_MAX_STEPS 4
+#define DEFAULT_STRATEGY STRATEGY_AGGRESSIVE
+#define STRAT_CMD_ARGUMENT_OFFSET 6
+
+/* Classification parameters */
+#define STATS_WINDOW_MS 1000
+#define MIN_SAMPLES_IN_VIEW 20      /* Opponent has to be observed for a while before it is classified */
+#define STATIONARY_DELTA_MM 5       /* Max change of distance between decisions for opponent to be considered stationary */
+#define STATIONARY_RATIO_PCT 80
+#define MIN_LOCKS 2
+#define EVASION_RATIO_PCT 50
+#define FAST_CLOSING_SPEED 300      /* mm per second */
+
+typedef struct Strategy_Profile_Tag{
+    Strategy_Thresholds_T thresholds;
+    uint8_t name_id;                                /* Progmem_Table_Index_T of profile name */
+    Maneuver_Step_T search[MANEUVER_MAX_STEPS];     /* Played in loop while there is no sensor input */
+    Maneuver_Step_T attack[MANEUVER_MAX_STEPS];     /* Played once target gets locked */
+} Strategy_Profile_T;
+
+/**
+ * @brief Statistics of opponent behavior. Opponent's own motion can only be observed while we are not driving forward, 
+ * therefore closing speed and stationary samples are collected in TRACKING status only.
+ */
+typedef struct Opponent_Stats_Tag{
+    uint16_t last_distance_mm;
+    uint16_t last_distance_ms;
+    int16_t closing_speed;          /* Filtered, mm per second, positive when opponent approaches */
+    uint16_t samples_in_view;
+    uint16_t stationary_samples;
+    uint8_t locks;
+    uint8_t evasions;               /* Locks lost without reaching the line */
+    uint16_t window_start_ms;
+    AI_Status_T previous_status;
+} Opponent_Stats_T;
+
+static const Strategy_Profile_T STRATEGY_PROFILES[STRATEGY_NUM] PROGMEM = {
+    [STRATEGY_AGGRESSIVE] = {
+        /* {trigger_mm, lock_mm, locked_range_mm, tracking_PWM, tracking_pulse_ms, escape_PWM} */
+        {270, 140, 60, 50, 2, 50},
+        PROGMEM_STRATEGY_AGGRESSIVE,
+        {{MOTORS_GO_FORWARD, 50, MANEUVER_HOLD}, {NULL, 0, 0}},
+        {{MOTORS_GO_FORWARD, 100, MANEUVER_HOLD}, {NULL, 0, 0}}
+    },
+    [STRATEGY_COUNTER_PUNCHER] = {
+        {300, 160, 60, 60, 2, 60},
+        PROGMEM_STRATEGY_COUNTER_PUNCHER,
+        {{MOTORS_TURN_RIGHT, 30, 150}, {MOTORS_STOP, 30, 350}, {NULL, 0, 0}},
+        {{MOTORS_TURN_LEFT, 60, 60}, {MOTORS_GO_FORWARD, 100, MANEUVER_HOLD}, {NULL, 0, 0}}
+    },
+    [STRATEGY_EDGE_TRAPPER] = {
+        {270, 120, 40, 40, 3, 50},
+        PROGMEM_STRATEGY_EDGE_TRAPPER,
+        {{MOTORS_GO_FORWARD, 40, MANEUVER_HOLD}, {NULL, 0, 0}},
+        {{MOTORS_GO_FORWARD, 70, 300}, {MOTORS_GO_FORWARD, 100, MANEUVER_HOLD}, {NULL, 0, 0}}
+    }
+};
+
+static Strategy_Thresholds_T active_thresholds;
+static Strategy_ID_T active_id = DEFAULT_STRATEGY;
+static bool auto_switching = true;
+static Opponent_Stats_T stats;
+
+/**********************************************************************
+* Static functions 
+***********************************************************************/
+static void activate_profile(Strategy_ID_T id){
+    memcpy_P(&active_thresholds, &STRATEGY_PROFILES[id].thresholds, sizeof(Strategy_Thresholds_T));
+    active_id = id;
+    strategy_print();
+}
+
+static void reset_stats(void){
+    memset(&stats, 0, sizeof(stats));
+    stats.window_start_ms = sys_tick_get_ms();
+    stats.previous_status = AI_SEARCH;
+}
+
+/**
+ * @brief Halves all counters, so observations older than few windows have no effect on classification
+ */
+static void decay_stats(void){
+    stats.samples_in_view >>= 1;
+    stats.stationary_samples >>= 1;
+    stats.locks >>= 1;
+    stats.evasions >>= 1;
+}
+
+static void update_motion_stats(uint16_t distance_mm, uint16_t now_ms){
+    uint16_t dt = now_ms - stats.last_distance_ms;
+    if(dt == 0){
+        return;
+    }
+    int16_t delta = (int16_t)stats.last_distance_mm - (int16_t)distance_mm;
+    int16_t speed = (int16_t)((int32_t)delta*1000/dt);
+    stats.closing_speed += (speed - stats.closing_speed)/4;
+    stats.samples_in_view++;
+    if(abs(delta) <= STATIONARY_DELTA_MM){
+        stats.stationary_samples++;
+    }
+}
+
+static Strategy_ID_T classify_opponent(void){
+    Strategy_ID_T result = active_id;
+    if(stats.samples_in_view >= MIN_SAMPLES_IN_VIEW && 
+       (uint32_t)stats.stationary_samples*100 >= (uint32_t)stats.samples_in_view*STATIONARY_RATIO_PCT){
+        result = STRATEGY_AGGRESSIVE;
+    } else if(stats.locks >= MIN_LOCKS && (uint16_t)stats.evasions*100 >= (uint16_t)stats.locks*EVASION_RATIO_PCT){
+        result = STRATEGY_EDGE_TRAPPER;
+    } else if(stats.closing_speed >= FAST_CLOSING_SPEED){
+        result = STRATEGY_COUNTER_PUNCHER;
+    }
+    return result;
+}
+
+/**********************************************************************
+* Public functions 
+***********************************************************************/
+/**
+ * @brief Prepares module for new match. Profile forced via serial is kept, otherwise default profile is activated.
+ */
+void strategy_init(void){
+    reset_stats();
+    activate_profile(auto_switching ? DEFAULT_STRATEGY : active_id);
+}
+
+/**
+ * @brief Updates opponent statistics with the latest decision of AI and switches the profile when window expires
+ * @param distance_mm Distance of the closest DS reading used for the decision
+ * @param AI_status   AI status resulting from the decision
+ */
+void strategy_update(uint16_t distance_mm, AI_Status_T AI_status){
+    uint16_t now_ms = sys_tick_get_ms();
+
+    if(AI_status == AI_TRACKING && stats.previous_status == AI_TRACKING){
+        update_motion_stats(distance_mm, now_ms);
+    }
+    if(AI_status == AI_ATTACK && stats.previous_status != AI_ATTACK && stats.locks < UINT8_MAX){
+        stats.locks++;
+    }
+    if(stats.previous_status == AI_ATTACK && (AI_status == AI_TRACKING || AI_status == AI_SEARCH) && stats.evasions < UINT8_MAX){
+        stats.evasions++;
+    }
+    stats.last_distance_mm = distance_mm;
+    stats.last_distance_ms = now_ms;
+    stats.previous_status = AI_status;
+
+    if((uint16_t)(now_ms - stats.window_start_ms) >= STATS_WINDOW_MS){
+        if(auto_switching){
+            Strategy_ID_T new_id = classify_opponent();
+            if(new_id != active_id){
+                activate_profile(new_id);
+            }
+        }
+        decay_stats();
+        stats.window_start_ms = now_ms;
+    }
+}
+
+const Strategy_Thresholds_T* strategy_get_thresholds(void){
+    return &active_thresholds;
+}
+
+/**
+ * @brief Returns PROGMEM table of search maneuver of the active profile
+ */
+const Maneuver_Step_T* strategy_get_search_maneuver(void){
+    return STRATEGY_PROFILES[active_id].search;
+}
+
+/**
+ * @brief Returns PROGMEM table of attack maneuver of the active profile
+ */
+const Maneuver_Step_T* strategy_get_attack_maneuver(void){
+    return STRATEGY_PROFILES[active_id].attack;
+}
+
+Strategy_ID_T strategy_get_id(void){
+    return active_id;
+}
+
+void strategy_print(void){
+    log_info_P(pgm_read_byte(&STRATEGY_PROFILES[active_id].name_id));
+}
+
+/* Debug callbacks */
+/**
+ * @brief Debug function to select the profile via UART
+ * @param data cmd with parameter: strat x, where x is profile number (0-2) or 'a' to enable automatic switching
+ * @param data_len size of @data
+ */
+void strategy_set_cbk(const void *data, size_t data_len){
+    const char arg = (data_len > STRAT_CMD_ARGUMENT_OFFSET) ? ((const char*)data)[STRAT_CMD_ARGUMENT_OFFSET] : '\0';
+    if(arg == 'a'){
+        auto_switching = true;
+        log_info_P(PROGMEM_STRATEGY_AUTO);
+    } else if(arg >= '0' && arg < '0'+STRATEGY_NUM){
+        auto_switching = false;
+        activate_profile((Strategy_ID_T)(arg-'0'));
+    } else {
+        strategy_print();
+    }
+}
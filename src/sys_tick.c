@@ -0,0 +1,50 @@
+/*! @file sys_tick.c
+    @brief System time base
+    TIMER2 works in CTC mode and generates an interrupt every 1 ms. Time is kept in 16 bits, so it wraps every ~65 s - always compare 
+    timestamps with sys_tick_elapsed_ms() instead of comparing them directly.
+*/
+
+#include <avr/io.h>
+#include <util/atomic.h>
+#include "config.h"
+#include "sys_tick.h"
+
+#define SYS_TICK_PRESCALER 64
+#define SYS_TICK_FREQ_HZ 1000
+#define SYS_TICK_OCR_VALUE ((F_CPU/SYS_TICK_PRESCALER/SYS_TICK_FREQ_HZ)-1)
+
+static volatile uint16_t tick_ms = 0;
+
+/**
+ * @brief Starts TIMER2 in CTC mode with prescaler 64 and enables compare match interrupt
+ */
+void sys_tick_init(void){
+    OCR2 = SYS_TICK_OCR_VALUE;
+    TCCR2 = (1<<WGM21)|(1<<CS22);
+    TIMSK |= (1<<OCIE2);
+}
+
+/**
+ * @brief Used in ISR to advance the time base
+ */
+void sys_tick_on_tick(void){
+    tick_ms++;
+}
+
+/**
+ * @brief Returns current time in milliseconds (16-bit read is done atomically)
+ */
+uint16_t sys_tick_get_ms(void){
+    uint16_t result;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        result = tick_ms;
+    }
+    return result;
+}
+
+/**
+ * @brief Returns time elapsed since @since_ms, handles counter wrap-around
+ */
+uint16_t sys_tick_elapsed_ms(uint16_t since_ms){
+    return sys_tick_get_ms() - since_ms;
+}
@@ -0,0 +1,214 @@
+/*! @file trim_calibration.c
+    @brief Straight-line calibration of wheel trims
+    Motors differ, with the same PWM on all wheels "forward" drifts sideways. MCU2 scales duty of every wheel by its trim, this module finds
+    trims which make the robot drive straight. Robot is placed facing a flat wall, then every iteration:
+    - measures difference of right and left DS distance to the wall (DS are mirrored, so the difference grows when the robot turns right),
+    - drives forward for TRIM_CAL_RUN_MS, measures the difference again - its change is the yaw gained while driving straight,
+    - slows down the faster side (positive change - robot turned right, left wheels are faster) and backs off to the start position.
+    Calibration ends when the yaw change is within tolerance. DS can't tell front wheels from rear ones, so both wheels of a side get
+    the same trim; trims of single wheels can be tuned on MCU2 (drvtm). Trims are stored in MCU2 EEPROM.
+    Calibration is started via serial command and executed from main loop while AI is IDLE, it blocks for several seconds.
+*/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "config.h"
+#include "serial_tx.h"
+#include "sys_tick.h"
+#include "sensor_hub.h"
+#include "maneuver.h"
+#include "ICCM.h"
+#include "ICCM_message_catalog.h"
+#include "AI.h"
+#include "trim_calibration.h"
+
+#define LOG_MODULE LOG_MODULE_TRIM_CALIBRATION
+
+#define TRIM_CAL_PWM 50
+#define TRIM_CAL_RUN_MS 500
+#define TRIM_CAL_SETTLE_MS 300          /* Robot stops and DS filters settle before measurement */
+#define TRIM_CAL_MAX_ITERATIONS 8
+#define TRIM_CAL_TOLERANCE_MM 4         /* Yaw change treated as straight drive */
+#define TRIM_CAL_GAIN 2                 /* Trim units (1/256) per mm of yaw change */
+#define TRIM_CAL_MAX_BALANCE (MANEUVER_TRIM_UNITY/2)
+#define TRIM_CAL_MIN_DISTANCE_MM 120    /* Leg is cut short when the wall gets closer */
+#define TRIM_CAL_MAX_DISTANCE_MM 600    /* Wall has to be in range of both sides */
+#define TRIM_CAL_SAMPLES 32
+#define TRIM_CAL_SAMPLE_PERIOD_MS 4
+#define TRIM_CMD_ARGUMENT_OFFSET 5
+
+/* Wheels of robot sides, see drive_ctrl.c */
+static const bool LEFT_WHEEL[MANEUVER_MOTOR_NUM] = {true, false, false, true};
+
+static int16_t balance = 0;     /* Positive - left wheels slowed down, negative - right wheels slowed down */
+static volatile char requested_cmd = '\0';
+
+/**********************************************************************
+* Static functions
+***********************************************************************/
+static void wait_ms(uint16_t delay_ms){
+    const uint16_t start_ms = sys_tick_get_ms();
+    while(sys_tick_elapsed_ms(start_ms) < delay_ms){
+    }
+}
+
+/**
+ * @brief Returns the closest distance seen by left and right DS in the snapshot
+ */
+static void get_side_distances(const Sensor_Snapshot_T *sensors, uint16_t *left_mm, uint16_t *right_mm){
+    *left_mm = UINT16_MAX;
+    *right_mm = UINT16_MAX;
+    for(uint8_t i = 0; i < DS_NUM; i++){
+        const uint16_t distance_mm = distance_sensor_adc_to_mm(sensors->ds_filtered[i]);
+        if((DS_LEFT_MASK & (1<<i)) && distance_mm < *left_mm){
+            *left_mm = distance_mm;
+        }
+        if((DS_RIGHT_MASK & (1<<i)) && distance_mm < *right_mm){
+            *right_mm = distance_mm;
+        }
+    }
+}
+
+/**
+ * @brief Measures averaged difference of right and left distance to the wall
+ * @param difference_mm Right minus left distance
+ * @return false if wall is not in range of both sides
+ */
+static bool measure_difference(int16_t *difference_mm){
+    int32_t sum = 0;
+    Sensor_Snapshot_T sensors;
+    for(uint8_t n = 0; n < TRIM_CAL_SAMPLES; n++){
+        uint16_t left_mm, right_mm;
+        wait_ms(TRIM_CAL_SAMPLE_PERIOD_MS);
+        sensor_hub_get_snapshot(&sensors);
+        get_side_distances(&sensors, &left_mm, &right_mm);
+        if(left_mm > TRIM_CAL_MAX_DISTANCE_MM || right_mm > TRIM_CAL_MAX_DISTANCE_MM){
+            return false;
+        }
+        sum += (int16_t)right_mm - (int16_t)left_mm;
+    }
+    *difference_mm = sum / TRIM_CAL_SAMPLES;
+    return true;
+}
+
+/**
+ * @brief Drives in given direction for TRIM_CAL_RUN_MS (motion queue of MCU2), driving forward stops early when the wall gets too close
+ * @return Duration of the leg in ms
+ */
+static uint16_t drive_leg(char *cmd){
+    const Maneuver_Step_T leg = {cmd, TRIM_CAL_PWM, TRIM_CAL_RUN_MS};
+    const uint16_t start_ms = sys_tick_get_ms();
+    uint16_t elapsed_ms;
+    Sensor_Snapshot_T sensors;
+
+    maneuver_send_queue(&leg, 1);
+    while((elapsed_ms = sys_tick_elapsed_ms(start_ms)) < TRIM_CAL_RUN_MS){
+        uint16_t left_mm, right_mm;
+        sensor_hub_get_snapshot(&sensors);
+        get_side_distances(&sensors, &left_mm, &right_mm);
+        if(cmd[0] == MOTORS_GO_FORWARD[0] && (left_mm < TRIM_CAL_MIN_DISTANCE_MM || right_mm < TRIM_CAL_MIN_DISTANCE_MM)){
+            ICCM_send(MOTORS_STOP);
+            break;
+        }
+    }
+    wait_ms(TRIM_CAL_SETTLE_MS);
+    return elapsed_ms;
+}
+
+/**
+ * @brief Converts side balance to wheel trims and sends them to MCU2
+ */
+static void send_trims(void){
+    uint16_t trims[MANEUVER_MOTOR_NUM];
+    for(uint8_t i = 0; i < MANEUVER_MOTOR_NUM; i++){
+        const int16_t reduction = LEFT_WHEEL[i] ? balance : -balance;
+        trims[i] = (reduction > 0) ? MANEUVER_TRIM_UNITY - reduction : MANEUVER_TRIM_UNITY;
+    }
+    maneuver_set_trims(trims);
+}
+
+/**********************************************************************
+* Public functions
+***********************************************************************/
+/**
+ * @brief Finds wheel trims for straight drive, robot has to face a flat wall within TRIM_CAL_MAX_DISTANCE_MM. Blocks for several seconds.
+ * Calibration starts from unity trims.
+ */
+void trim_calibration_measure(void){
+    log_info_P(PROGMEM_TRIM_CALIBRATION_STARTED);
+    balance = 0;
+    send_trims();
+    for(uint8_t iteration = 1; iteration <= TRIM_CAL_MAX_ITERATIONS; iteration++){
+        int16_t start_mm, end_mm;
+        if(!measure_difference(&start_mm)){
+            log_info_P(PROGMEM_TRIM_CALIBRATION_NO_WALL);
+            return;
+        }
+        const uint16_t leg_ms = drive_leg(MOTORS_GO_FORWARD);
+        if(!measure_difference(&end_mm)){
+            log_info_P(PROGMEM_TRIM_CALIBRATION_NO_WALL);
+            return;
+        }
+        const int16_t yaw_mm = end_mm - start_mm;
+        log_data_2("Trim it%u yaw=%dmm", iteration, yaw_mm);
+        if(abs(yaw_mm) <= TRIM_CAL_TOLERANCE_MM){
+            break;
+        }
+        balance += yaw_mm * TRIM_CAL_GAIN;
+        if(balance > TRIM_CAL_MAX_BALANCE){
+            balance = TRIM_CAL_MAX_BALANCE;
+        } else if(balance < -TRIM_CAL_MAX_BALANCE){
+            balance = -TRIM_CAL_MAX_BALANCE;
+        }
+        send_trims();
+        /* Back to the start position, backward drive has the same duration as the forward one */
+        const Maneuver_Step_T back_off = {MOTORS_GO_BACKWARD, TRIM_CAL_PWM, leg_ms};
+        maneuver_send_queue(&back_off, 1);
+        wait_ms(leg_ms + TRIM_CAL_SETTLE_MS);
+    }
+    trim_calibration_print();
+}
+
+/**
+ * @brief Executes calibration requested via serial, called from main loop. Ignored unless AI is IDLE.
+ */
+void trim_calibration_run(void){
+    const char cmd = requested_cmd;
+    if(cmd == '\0'){
+        return;
+    }
+    requested_cmd = '\0';
+    if(AI_get_status() != AI_IDLE){
+        return;
+    }
+    if(cmd == 's'){
+        trim_calibration_measure();
+    } else if(cmd == 'r'){
+        balance = 0;
+        send_trims();
+        trim_calibration_print();
+    }
+}
+
+/**
+ * @brief Prints side balance found by the last calibration via serial
+ */
+void trim_calibration_print(void){
+    log_data_2("Trim L=%u R=%u",
+               (balance > 0) ? MANEUVER_TRIM_UNITY - balance : MANEUVER_TRIM_UNITY,
+               (balance < 0) ? MANEUVER_TRIM_UNITY + balance : MANEUVER_TRIM_UNITY);
+}
+
+/* Debug callbacks */
+/**
+ * @brief Serial command: "trim s" starts calibration (robot facing a wall), "trim r" resets trims to unity, "trim" prints results
+ */
+void trim_calibration_cbk(const void *data, size_t data_len){
+    const char *cmd = (const char*)data;
+    if(data_len > TRIM_CMD_ARGUMENT_OFFSET && (cmd[TRIM_CMD_ARGUMENT_OFFSET] == 's' || cmd[TRIM_CMD_ARGUMENT_OFFSET] == 'r')){
+        /* Serial callbacks run in ISR, calibration is done in main loop */
+        requested_cmd = cmd[TRIM_CMD_ARGUMENT_OFFSET];
+    } else {
+        trim_calibration_print();
+    }
+}
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Generates distance sensor lookup table (ADC reading -> millimetres) from calibration CSV.
+
+Usage: gen_ds_lut.py <calibration.csv> <output.h>
+
+Table has one entry every 2^LUT_SHIFT ADC counts, so the MCU finds the segment with a shift and
+interpolates linearly inside it. Between calibration points distance is interpolated in 1/distance
+space, which is close to linear for IR triangulation sensors. Readings outside of the calibrated range
+are clamped to the nearest calibration point.
+"""
+import csv
+import sys
+
+ADC_MAX = 1024
+LUT_SHIFT = 5
+LUT_SIZE = (ADC_MAX >> LUT_SHIFT) + 1
+
+
+def read_calibration(path):
+    points = []
+    with open(path, newline='') as csv_file:
+        rows = (line for line in csv_file if line.strip() and not line.lstrip().startswith('#'))
+        for row in csv.DictReader(rows):
+            points.append((int(row['adc']), int(row['distance_mm'])))
+    if len(points) < 2:
+        sys.exit('%s: at least two calibration points are required' % path)
+    points.sort()
+    for (adc_a, mm_a), (adc_b, mm_b) in zip(points, points[1:]):
+        if adc_a == adc_b or mm_b > mm_a:
+            sys.exit('%s: distance must strictly decrease with ADC reading' % path)
+    return points
+
+
+def distance_at(points, adc):
+    if adc <= points[0][0]:
+        return points[0][1]
+    if adc >= points[-1][0]:
+        return points[-1][1]
+    for (adc_a, mm_a), (adc_b, mm_b) in zip(points, points[1:]):
+        if adc_a <= adc <= adc_b:
+            ratio = (adc - adc_a) / (adc_b - adc_a)
+            inverse = 1.0 / mm_a + ratio * (1.0 / mm_b - 1.0 / mm_a)
+            return 1.0 / inverse
+    raise AssertionError('unreachable')
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    points = read_calibration(sys.argv[1])
+    table = [int(round(distance_at(points, i << LUT_SHIFT))) for i in range(LUT_SIZE)]
+    lines = []
+    for i in range(0, LUT_SIZE, 8):
+        lines.append('    ' + ', '.join('%4d' % v for v in table[i:i + 8]))
+    with open(sys.argv[2], 'w') as out:
+        out.write('/* Generated by tools/gen_ds_lut.py from %s - do not edit */\n' % sys.argv[1])
+        out.write('#ifndef DS_LUT_GUARD\n#define DS_LUT_GUARD\n\n')
+        out.write('#include <stdint.h>\n#include <avr/pgmspace.h>\n\n')
+        out.write('#define DS_LUT_SHIFT %d\n' % LUT_SHIFT)
+        out.write('#define DS_LUT_SIZE %d\n' % LUT_SIZE)
+        out.write('#define DS_LUT_MAX_MM %d\n\n' % max(table))
+        out.write('/* Distance in mm for ADC reading i<<DS_LUT_SHIFT */\n')
+        out.write('static const uint16_t DS_LUT_MM[DS_LUT_SIZE] PROGMEM = {\n')
+        out.write(',\n'.join(lines))
+        out.write('\n};\n\n#endif /* DS_LUT_GUARD */\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Generates dictionary of log sites used to decode binary logs (see LOG_BINARY in serial_tx.h).
+
+Usage: gen_log_dict.py <include dir> <source dir> <output.json>
+
+Log ID of a site is module ID << LOG_LINE_BITS | line, module IDs are positions in LOG_MODULE_LIST
+(log_modules.h). Every log macro call found in module sources is stored with its type and text
+(string literal or log_data_N format). PROGMEM strings are stored in the order of Progmem_Table_Index_T,
+binary records of log_*_P sites carry the index. Log macro calls have to start on a single line with
+their string literal or format.
+"""
+import json
+import os
+import re
+import sys
+
+LINE_BITS = 11
+SYNC_BYTE = 0xA5
+RECORD_HEADER_SIZE = 3      # Sync byte and log ID, LOG_RECORD_HEADER_SIZE in serial_tx.c
+RECORD_MAX_SIZE = 32        # LOG_RECORD_MAX_SIZE in serial_tx.c
+
+MODULE_RE = re.compile(r'X\((LOG_MODULE_\w+),\s*"([^"]+)"\)')
+SITE_RE = re.compile(r'\b(log_info_P|log_warn_P|log_err_P|log_info|log_warn|log_err|log_raw_string|log_data_[1-8])\s*\(')
+LITERAL_RE = re.compile(r'"((?:[^"\\]|\\.)*)"')
+PROGMEM_INDEX_RE = re.compile(r'^\s*(PROGMEM_\w+)\s*(?:=\s*0\s*)?,?\s*$')
+PROGMEM_STRING_RE = re.compile(r'(PROGMEM_\w+)_P\[\]\s+PROGMEM\s*=\s*"((?:[^"\\]|\\.)*)"')
+SPEC_RE = re.compile(r'%[0-9+\- #]*(l?)(.)')
+LOG_TYPES = {'info': 'INFO', 'warn': 'WARNING', 'err': 'ERROR'}
+
+
+def unescape(literal):
+    return literal.encode('latin-1').decode('unicode_escape')
+
+
+def read(path):
+    with open(path, encoding='latin-1') as src:
+        return src.read()
+
+
+def read_modules(include_dir):
+    modules = MODULE_RE.findall(read(os.path.join(include_dir, 'log_modules.h')))
+    if len(modules) > (1 << (16 - LINE_BITS)):
+        sys.exit('log_modules.h: too many modules')
+    return modules
+
+
+def read_progmem_strings(include_dir, src_dir):
+    header = read(os.path.join(include_dir, 'serial_progmem.h'))
+    enum_body = header[header.index('{', header.index('Progmem_Table_Index_Tag')) + 1:header.index('}')]
+    names = [m.group(1) for m in (PROGMEM_INDEX_RE.match(line) for line in enum_body.splitlines()) if m]
+    strings = dict((name, unescape(text)) for name, text in PROGMEM_STRING_RE.findall(read(os.path.join(src_dir, 'serial_progmem.c'))))
+    missing = [name for name in names if name not in strings]
+    if missing:
+        sys.exit('serial_progmem.c: missing strings for %s' % ', '.join(missing))
+    return [strings[name] for name in names]
+
+
+def min_record_size(fmt):
+    """Size of binary record of log_data_N site with empty strings, walks the format like serial_log_binary_data."""
+    size = RECORD_HEADER_SIZE
+    for is_long, conversion in SPEC_RE.findall(fmt):
+        if conversion == 's':
+            size += 1
+        elif conversion != '%':
+            size += 4 if is_long else 2
+    return size
+
+
+def read_sites(path, module_id, module):
+    source = read(path)
+    sites = {}
+    for line_num, line in enumerate(source.splitlines(), 1):
+        if line.lstrip().startswith('#'):
+            continue
+        for match in SITE_RE.finditer(line):
+            if '#define LOG_MODULE %s' % module not in source:
+                sys.exit('%s: log sites without "#define LOG_MODULE %s"' % (path, module))
+            if line_num >= (1 << LINE_BITS):
+                sys.exit('%s:%d: log site beyond line %d' % (path, line_num, (1 << LINE_BITS) - 1))
+            macro = match.group(1)
+            literals = LITERAL_RE.findall(line[match.end():])
+            if macro.endswith('_P'):
+                kind, log_type, text = 'progmem', LOG_TYPES[macro[4:-2]], None
+            elif macro == 'log_raw_string':
+                kind, log_type, text = 'raw', 'INFO', unescape(literals[0]) if literals else ''
+            elif macro.startswith('log_data_'):
+                kind, log_type, text = 'data', 'INFO', unescape(literals[0]) if literals else ''
+                if min_record_size(text) > RECORD_MAX_SIZE:
+                    sys.exit('%s:%d: arguments don\'t fit into binary log record (%d bytes)' % (path, line_num, RECORD_MAX_SIZE))
+            else:
+                kind, log_type, text = 'text', LOG_TYPES[macro[4:]], unescape(literals[0]) if literals else ''
+            log_id = (module_id << LINE_BITS) | line_num
+            sites[str(log_id)] = {'file': os.path.basename(path), 'line': line_num, 'type': log_type, 'kind': kind, 'text': text}
+    return sites
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.exit(__doc__)
+    include_dir, src_dir, out_path = sys.argv[1:]
+    sites = {}
+    for module_id, (module, filename) in enumerate(read_modules(include_dir)):
+        path = os.path.join(src_dir, filename)
+        if not os.path.exists(path):
+            sys.exit('log_modules.h: %s does not exist' % path)
+        sites.update(read_sites(path, module_id, module))
+    dictionary = {
+        'sync_byte': SYNC_BYTE,
+        'line_bits': LINE_BITS,
+        'progmem': read_progmem_strings(include_dir, src_dir),
+        'sites': sites,
+    }
+    with open(out_path, 'w') as out:
+        json.dump(dictionary, out, indent=1, sort_keys=True)
+
+
+if __name__ == '__main__':
+    main()
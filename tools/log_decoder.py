@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Decodes binary log stream (build with LOG_FORMAT=binary) into readable lines.
+
+Usage: log_decoder.py <log_dict.json> [binary log file]
+
+Reads stdin if no file is given, e.g. for live decoding:
+    stty -F /dev/ttyUSB0 9600 raw && python3 tools/log_decoder.py out/log_dict.json < /dev/ttyUSB0
+Dictionary is generated by tools/gen_log_dict.py during build and has to match the flashed image.
+Record: sync byte, log ID (2 bytes), arguments - see serial_tx.h. Bytes which don't start a record
+with known ID are skipped.
+"""
+import json
+import re
+import sys
+
+SPEC_RE = re.compile(r'%([-+ #0-9]*)(l?)([diuxXcs%])')
+
+
+class Stream:
+    def __init__(self, src):
+        self.src = src
+
+    def byte(self):
+        data = self.src.read(1)
+        if not data:
+            raise EOFError
+        return data[0]
+
+    def integer(self, size, signed):
+        value = 0
+        for i in range(size):
+            value |= self.byte() << (8 * i)
+        if signed and value & (1 << (8 * size - 1)):
+            value -= 1 << (8 * size)
+        return value
+
+    def string(self):
+        chars = []
+        while True:
+            c = self.byte()
+            if c == 0:
+                return ''.join(chars)
+            chars.append(chr(c))
+
+
+def format_data(fmt, stream):
+    def convert(match):
+        flags, long_mod, conv = match.groups()
+        if conv == '%':
+            return '%'
+        if conv == 's':
+            return ('%' + flags + 's') % stream.string()
+        value = stream.integer(4 if long_mod else 2, conv in 'di')
+        if conv == 'c':
+            return chr(value & 0xFF)
+        return ('%' + flags + ('d' if conv in 'diu' else conv)) % value
+    return SPEC_RE.sub(convert, fmt)
+
+
+def decode_record(site, dictionary, stream):
+    if site['kind'] == 'progmem':
+        index = stream.byte()
+        strings = dictionary['progmem']
+        return strings[index] if index < len(strings) else '<PROGMEM string %d>' % index
+    if site['kind'] == 'data':
+        return format_data(site['text'], stream)
+    return site['text']
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.exit(__doc__)
+    with open(sys.argv[1]) as dict_file:
+        dictionary = json.load(dict_file)
+    src = open(sys.argv[2], 'rb') if len(sys.argv) == 3 else sys.stdin.buffer
+    stream = Stream(src)
+    sync_byte = dictionary['sync_byte']
+    sites = dictionary['sites']
+    try:
+        while True:
+            if stream.byte() != sync_byte:
+                continue
+            log_id = stream.integer(2, False)
+            site = sites.get(str(log_id))
+            if site is None:
+                continue
+            text = decode_record(site, dictionary, stream)
+            if site['kind'] == 'raw':
+                sys.stdout.write(text)
+            else:
+                sys.stdout.write('%-8.8s:%-4d %s %s\n' % (site['file'], site['line'], site['type'], text))
+            sys.stdout.flush()
+    except EOFError:
+        pass
+
+
+if __name__ == '__main__':
+    main()